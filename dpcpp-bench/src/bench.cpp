@@ -0,0 +1,258 @@
+/*
+GEMM benchmark driver. Any kernel configuration on any shape, no recompilation.
+C[M, P] = A[M, N] * B[N, P]
+
+Usage: bench [-k kernels] [-s shapes] [-w warmup] [-r reps] [--csv file] [--json file] [--roofline file] [-l]
+	-k: comma separated kernels. Registry configurations (eg: reg_64x64x16_8x8),
+	    "sgemm" (BLAS front end), "cpu" (host backend) or "all". Default: sgemm
+	-s: comma separated MxNxP shapes (eg: 1024x1024x1024,4096x512x4096). Default: 1024x1024x1024
+	-w: untimed runs first, the first one pays JIT compilation. Default: 2
+	-r: timed runs. Default: 10
+	--csv, --json: also write the results to a file. CSV always goes to stdout, everything
+	    else (device banner, progress, library messages) to stderr, so stdout parses as CSV.
+	--roofline: measure the device's bandwidth and FLOPs roofs and place the best run of
+	    each registry configuration on them (roofline.h). Report to stderr, CSV to the file.
+	-l: list the registry configurations and exit.
+*/
+
+/* Scope timers are compiled out: the driver times each call itself */
+#define PROFILING 0
+
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "nanoblas.h"
+#include "registry.h"
+#include "autotune.h"
+#include "sgemm.h"
+#include "cpu_gemm.h"
+#include "philox.h"
+#include "roofline.h"
+
+struct Shape {
+	size_t M, N, P;
+};
+
+struct Result {
+	std::string Kernel;
+	Shape Dims;
+	int Reps;
+	double Min, Median, P95, Mean, StdDev;	// Seconds per call
+};
+
+std::vector<std::string> Split(const std::string& list, char sep) {
+	std::vector<std::string> items;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, sep))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+bool ParseShape(const std::string& text, Shape& shape) {
+	std::vector<std::string> dims = Split(text, 'x');
+	if (dims.size() != 3)
+		return false;
+	try {
+		shape = { std::stoul(dims[0]), std::stoul(dims[1]), std::stoul(dims[2]) };
+	}
+	catch (std::exception const&) {
+		return false;
+	}
+	return shape.M > 0 && shape.N > 0 && shape.P > 0;
+}
+
+// Order statistics by nearest rank
+Result Summarize(const std::string& kernel, const Shape& shape, std::vector<double> times) {
+	std::sort(times.begin(), times.end());
+	const size_t n = times.size();
+	double mean = 0;
+	for (double t : times)
+		mean += t;
+	mean /= n;
+	double var = 0;
+	for (double t : times)
+		var += (t - mean) * (t - mean);
+	const double median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+	const size_t p95 = std::min(n - 1, static_cast<size_t>(std::ceil(0.95 * n)) - 1);
+	return { kernel, shape, static_cast<int>(n), times.front(), median, times[p95], mean, n > 1 ? std::sqrt(var / (n - 1)) : 0.0 };
+}
+
+// `call` runs one blocking GEMM
+std::vector<double> Time(const std::function<void()>& call, int warmup, int reps) {
+	for (int i = 0; i < warmup; i++)
+		call();
+	std::vector<double> times;
+	for (int i = 0; i < reps; i++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		call();
+		auto end = std::chrono::high_resolution_clock::now();
+		times.push_back(std::chrono::duration<double>(end - start).count());
+	}
+	return times;
+}
+
+void WriteCsv(std::ostream& out, const std::vector<Result>& results) {
+	out << "kernel,M,N,P,reps,min_s,median_s,p95_s,mean_s,stddev_s,gflops_best,gflops_median\n";
+	for (const Result& r : results) {
+		out << r.Kernel << "," << r.Dims.M << "," << r.Dims.N << "," << r.Dims.P << "," << r.Reps << ","
+			<< r.Min << "," << r.Median << "," << r.P95 << "," << r.Mean << "," << r.StdDev << ","
+			<< GEMM_GIGAFLOPS(r.Dims.M, r.Dims.N, r.Dims.P, r.Min) << ","
+			<< GEMM_GIGAFLOPS(r.Dims.M, r.Dims.N, r.Dims.P, r.Median) << "\n";
+	}
+}
+
+void WriteJson(std::ostream& out, const std::string& device, const std::vector<Result>& results) {
+	out << "{\"device\": \"" << device << "\", \"results\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		out << (i ? ", " : "") << "{"
+			<< "\"kernel\": \"" << r.Kernel << "\", "
+			<< "\"M\": " << r.Dims.M << ", \"N\": " << r.Dims.N << ", \"P\": " << r.Dims.P << ", "
+			<< "\"reps\": " << r.Reps << ", "
+			<< "\"min_s\": " << r.Min << ", \"median_s\": " << r.Median << ", \"p95_s\": " << r.P95 << ", "
+			<< "\"mean_s\": " << r.Mean << ", \"stddev_s\": " << r.StdDev << ", "
+			<< "\"gflops_best\": " << GEMM_GIGAFLOPS(r.Dims.M, r.Dims.N, r.Dims.P, r.Min) << ", "
+			<< "\"gflops_median\": " << GEMM_GIGAFLOPS(r.Dims.M, r.Dims.N, r.Dims.P, r.Median)
+			<< "}";
+	}
+	out << "]}\n";
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> kernels{ "sgemm" };
+	std::vector<Shape> shapes{ { 1024, 1024, 1024 } };
+	int warmup = 2, reps = 10;
+	std::string csvPath, jsonPath, rooflinePath;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "-l") {
+			nanoblas::Registry::Get().Print();
+			return 0;
+		}
+		else if (arg == "-k" && hasValue)
+			kernels = Split(argv[++i], ',');
+		else if (arg == "-s" && hasValue) {
+			shapes.clear();
+			for (const std::string& text : Split(argv[++i], ',')) {
+				Shape shape;
+				if (!ParseShape(text, shape)) {
+					std::cout << "Bad shape: " << text << " (expected MxNxP)\n";
+					return -1;
+				}
+				shapes.push_back(shape);
+			}
+		}
+		else if (arg == "-w" && hasValue)
+			warmup = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-r" && hasValue)
+			reps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--csv" && hasValue)
+			csvPath = argv[++i];
+		else if (arg == "--json" && hasValue)
+			jsonPath = argv[++i];
+		else if (arg == "--roofline" && hasValue)
+			rooflinePath = argv[++i];
+		else {
+			std::cout << "Unknown argument: " << arg << "\n";
+			return -1;
+		}
+	}
+
+	if (kernels.size() == 1 && kernels[0] == "all") {
+		kernels = { "sgemm", "cpu" };
+		for (const nanoblas::GemmEntry& entry : nanoblas::Registry::Get().Entries())
+			kernels.push_back(entry.Config.Name());
+	}
+	for (const std::string& kernel : kernels) {
+		if (kernel != "sgemm" && kernel != "cpu" && nanoblas::Registry::Get().Find(kernel) == nullptr) {
+			std::cout << "Unknown kernel: " << kernel << "\n";
+			nanoblas::Registry::Get().Print();
+			return -1;
+		}
+	}
+
+	std::vector<Result> results;
+	std::string device;
+	/* Library output (device banner, autotuner, warnings) goes to stderr until the CSV */
+	std::streambuf* stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+	try {
+		nanoblas::Context ctx(create_device_queue());
+		device = ctx.Device().get_info<sycl::info::device::name>();
+		nanoblas::RooflineReport roofline(rooflinePath.empty() ? nanoblas::DevicePeaks{ 1, 1 } : nanoblas::MeasurePeaks(ctx));
+
+		for (const Shape& shape : shapes) {
+			const size_t M = shape.M, N = shape.N, P = shape.P;
+			std::cerr << "Shape " << M << "x" << N << "x" << P << "\n";
+
+			/* Operands are generated on the device: no host round trip per shape */
+			nanoblas::Matrix a(ctx, M, N), b(ctx, N, P), c(ctx, M, P);
+			auto small_int = [](uint32_t word) { return float(word % 5); };
+			nanoblas::PhiloxFillDevice(ctx.Queue(), nanoblas::Philox(39872, 0), a.Data(), a.Size(), small_int).wait();
+			nanoblas::PhiloxFillDevice(ctx.Queue(), nanoblas::Philox(39872, 1), b.Data(), b.Size(), small_int).wait();
+			std::vector<float> a_host, b_host, c_host;
+
+			for (const std::string& kernel : kernels) {
+				std::function<void()> call;
+				if (kernel == "sgemm") {
+					call = [&]() { nanoblas::sgemm(ctx, nanoblas::Transpose::None, nanoblas::Transpose::None, 1.0f, a, b, 0.0f, c); };
+				}
+				else if (kernel == "cpu") {
+					if (a_host.empty()) {
+						a_host.resize(a.Size()); b_host.resize(b.Size()); c_host.resize(c.Size());
+						a.CopyToHost(a_host.data());
+						b.CopyToHost(b_host.data());
+					}
+					call = [&]() { nanoblas::cpu::sgemm(M, P, N, 1.0f, a_host.data(), N, b_host.data(), P, 0.0f, c_host.data(), P); };
+				}
+				else {
+					const nanoblas::GemmEntry* entry = nanoblas::Registry::Get().Find(kernel);
+					if (!nanoblas::Autotuner::Fits(entry->Config, ctx.Device())) {
+						std::cerr << "\tSkipping " << kernel << ": does not fit the device\n";
+						continue;
+					}
+					call = [&ctx, &a, &b, &c, entry]() { (*entry)(ctx, a, b, c); };
+				}
+				results.push_back(Summarize(kernel, shape, Time(call, warmup, reps)));
+				std::cerr << "\t" << kernel << ": " << GEMM_GIGAFLOPS(M, N, P, results.back().Median) << " GFLOPS (median)\n";
+				/* Only registry kernels have a traffic model */
+				if (const nanoblas::GemmEntry* entry = nanoblas::Registry::Get().Find(kernel))
+					roofline.Add(entry->Config, M, N, P, results.back().Min);
+			}
+		}
+		if (!rooflinePath.empty()) {
+			roofline.Print(std::cerr);
+			roofline.WriteCsv(rooflinePath);
+		}
+	}
+	catch (std::exception const& e) {
+		std::cerr << "Exception while benchmarking: " << e.what() << "\n";
+		std::cout.rdbuf(stdoutBuffer);
+		return -1;
+	}
+	std::cout.rdbuf(stdoutBuffer);
+
+	WriteCsv(std::cout, results);
+	if (!csvPath.empty()) {
+		std::ofstream csv(csvPath);
+		WriteCsv(csv, results);
+	}
+	if (!jsonPath.empty()) {
+		std::ofstream json(jsonPath);
+		WriteJson(json, device, results);
+	}
+	return 0;
+}
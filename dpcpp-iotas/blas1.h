@@ -0,0 +1,244 @@
+#pragma once
+/*
+Level-1 BLAS on device-resident USM vectors: axpy, scal, copy, dot, nrm2, asum.
+Templated over the element type, instantiated for float, double and int. Unit stride only.
+
+Every op is bandwidth bound, so every kernel
+	1. moves WIDTH elements (16 bytes) per load and store as sycl::vec, when every operand
+	   is 16-byte aligned (any DeviceVector is). Offset pointers fall back to scalar accesses
+	2. runs a fixed grid sized to the device (GROUPS_PER_CU work-groups per compute unit)
+	   with a grid-stride loop: one launch covers any length, no per-element work-items
+Elementwise ops return their event and do not wait. Reductions (reduction.h) wait and return the value.
+*/
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "reduction.h"
+
+namespace iotas {
+	// Elements per 16-byte vector access
+	template <typename T>
+	constexpr int VecWidth() { return static_cast<int>(16 / sizeof(T)); }
+
+	// Reductions accumulate ints in 64 bits, floating point in its own type
+	template <typename T>
+	using Accum = std::conditional_t<std::is_integral<T>::value, int64_t, T>;
+
+	// Norms of int vectors are real
+	template <typename T>
+	using Real = std::conditional_t<std::is_integral<T>::value, double, T>;
+
+	// sycl::vec loads and stores of p are aligned
+	template <typename T>
+	bool VecAligned(const T* p) { return reinterpret_cast<uintptr_t>(p) % sizeof(sycl::vec<T, VecWidth<T>()>) == 0; }
+
+	// Base of the lazy elementwise expressions of expression.h
+	struct Expression {};
+
+	template <typename T>
+	class DeviceVector {
+		// Owns n elements of device USM, allocated once and reused by every op
+	private:
+		sycl::queue* m_Queue;
+		T* m_Data;
+		size_t m_Size;
+
+	public:
+		DeviceVector(sycl::queue& q, size_t n)
+			: m_Queue(&q), m_Data(sycl::malloc_device<T>(n, q)), m_Size(n)
+		{
+			if (m_Data == nullptr) {
+				std::cout << "Failed to allocate " << n * sizeof(T) / 1024 / 1024 << " MB on device.\n";
+				std::terminate();
+			}
+		}
+
+		DeviceVector(sycl::queue& q, const std::vector<T>& host)
+			: DeviceVector(q, host.size())
+		{
+			CopyFromHost(host.data()).wait();
+		}
+
+		~DeviceVector() {
+			if (m_Data != nullptr)
+				sycl::free(m_Data, *m_Queue);
+		}
+
+		DeviceVector(const DeviceVector&) = delete;
+		DeviceVector& operator=(const DeviceVector&) = delete;
+
+		DeviceVector(DeviceVector&& other) noexcept
+			: m_Queue(other.m_Queue), m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0))
+		{
+
+		}
+
+		// Evaluate an expression (expression.h) into this vector in one kernel, and wait
+		template <typename E, typename = std::enable_if_t<std::is_base_of<Expression, E>::value>>
+		DeviceVector& operator=(const E& e) {
+			Assign(*this, e).wait();
+			return *this;
+		}
+
+		sycl::queue& Queue() const { return *m_Queue; }
+		T* Data() { return m_Data; }
+		const T* Data() const { return m_Data; }
+		size_t Size() const { return m_Size; }
+
+		sycl::event CopyFromHost(const T* host, const std::vector<sycl::event>& deps = {}) {
+			return m_Queue->memcpy(m_Data, host, m_Size * sizeof(T), deps);
+		}
+
+		sycl::event CopyToHost(T* host, const std::vector<sycl::event>& deps = {}) const {
+			return m_Queue->memcpy(host, m_Data, m_Size * sizeof(T), deps);
+		}
+	};
+
+	//-----------------------------------------------------------------------------
+	// Grid-stride elementwise kernel: vop(i) on whole vectors [0, n / W), then
+	// sop(i) on the leftover elements. vop needs every pointer it touches aligned
+	// to 16 bytes, which every USM allocation is: pass vectorized = false otherwise
+	// and sop runs on all n elements.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename VecOp, typename ScalarOp>
+	sycl::event Elementwise(sycl::queue& q, size_t n, VecOp vop, ScalarOp sop, const std::vector<sycl::event>& deps,
+		bool vectorized = true) {
+		constexpr int W = VecWidth<T>();
+		const size_t vecs = vectorized ? n / W : 0;
+		const Grid grid = GridFor(q, std::max<size_t>(vectorized ? vecs : n, 1));
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			h.parallel_for(grid.Range(), [=](sycl::nd_item<1> item) {
+				const size_t stride = item.get_global_range(0);
+				const size_t gid = item.get_global_id(0);
+				for (size_t v = gid; v < vecs; v += stride)
+					vop(v);
+				for (size_t i = vecs * W + gid; i < n; i += stride)
+					sop(i);
+			});
+		});
+	}
+
+	//-----------------------------------------------------------------------------
+	// Sum of fvec(v) over whole vectors [0, n / W) and f(i) over the leftover
+	// elements, or f(i) over all of them when not vectorized (as in Elementwise).
+	// Each work-item folds one vector per step. Blocking.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename VecTerm, typename Term>
+	Accum<T> VecReduce(sycl::queue& q, size_t n, VecTerm fvec, Term f, const std::vector<sycl::event>& deps,
+		bool vectorized = true) {
+		constexpr int W = VecWidth<T>();
+		const size_t vecs = vectorized ? n / W : 0;
+		return Reduce<Accum<T>>(q, vecs + (n - vecs * W),
+			[=](size_t u) { return u < vecs ? fvec(u) : f(vecs * W + (u - vecs)); }, SumOp<Accum<T>>(), deps);
+	}
+
+	// y = alpha * x + y
+	template <typename T>
+	sycl::event axpy(sycl::queue& q, size_t n, T alpha, const T* x, T* y, const std::vector<sycl::event>& deps = {}) {
+		using V = sycl::vec<T, VecWidth<T>()>;
+		const V* xv = reinterpret_cast<const V*>(x);
+		V* yv = reinterpret_cast<V*>(y);
+		return Elementwise<T>(q, n,
+			[=](size_t v) { yv[v] = xv[v] * alpha + yv[v]; },
+			[=](size_t i) { y[i] = alpha * x[i] + y[i]; }, deps, VecAligned(x) && VecAligned(y));
+	}
+
+	// x = alpha * x
+	template <typename T>
+	sycl::event scal(sycl::queue& q, size_t n, T alpha, T* x, const std::vector<sycl::event>& deps = {}) {
+		using V = sycl::vec<T, VecWidth<T>()>;
+		V* xv = reinterpret_cast<V*>(x);
+		return Elementwise<T>(q, n,
+			[=](size_t v) { xv[v] = xv[v] * alpha; },
+			[=](size_t i) { x[i] = alpha * x[i]; }, deps, VecAligned(x));
+	}
+
+	// y = x
+	template <typename T>
+	sycl::event copy(sycl::queue& q, size_t n, const T* x, T* y, const std::vector<sycl::event>& deps = {}) {
+		using V = sycl::vec<T, VecWidth<T>()>;
+		const V* xv = reinterpret_cast<const V*>(x);
+		V* yv = reinterpret_cast<V*>(y);
+		return Elementwise<T>(q, n,
+			[=](size_t v) { yv[v] = xv[v]; },
+			[=](size_t i) { y[i] = x[i]; }, deps, VecAligned(x) && VecAligned(y));
+	}
+
+	// sum(x[i] * y[i])
+	template <typename T>
+	Accum<T> dot(sycl::queue& q, size_t n, const T* x, const T* y, const std::vector<sycl::event>& deps = {}) {
+		using V = sycl::vec<T, VecWidth<T>()>;
+		const V* xv = reinterpret_cast<const V*>(x);
+		const V* yv = reinterpret_cast<const V*>(y);
+		return VecReduce<T>(q, n,
+			[=](size_t v) {
+				/* Widen before multiplying: int products overflow 32 bits */
+				const V a = xv[v], b = yv[v];
+				Accum<T> s = 0;
+				for (int w = 0; w < VecWidth<T>(); w++)
+					s += static_cast<Accum<T>>(a[w]) * b[w];
+				return s;
+			},
+			[=](size_t i) { return static_cast<Accum<T>>(x[i]) * y[i]; }, deps, VecAligned(x) && VecAligned(y));
+	}
+
+	// sqrt(sum(x[i]^2)). No scaling: squares of float vectors with |x| > 1e19 overflow
+	template <typename T>
+	Real<T> nrm2(sycl::queue& q, size_t n, const T* x, const std::vector<sycl::event>& deps = {}) {
+		return std::sqrt(static_cast<Real<T>>(dot(q, n, x, x, deps)));
+	}
+
+	// sum(|x[i]|)
+	template <typename T>
+	Accum<T> asum(sycl::queue& q, size_t n, const T* x, const std::vector<sycl::event>& deps = {}) {
+		using V = sycl::vec<T, VecWidth<T>()>;
+		const V* xv = reinterpret_cast<const V*>(x);
+		return VecReduce<T>(q, n,
+			[=](size_t v) {
+				const V a = xv[v];
+				Accum<T> s = 0;
+				for (int w = 0; w < VecWidth<T>(); w++)
+					s += a[w] < 0 ? -static_cast<Accum<T>>(a[w]) : static_cast<Accum<T>>(a[w]);
+				return s;
+			},
+			[=](size_t i) { return x[i] < 0 ? -static_cast<Accum<T>>(x[i]) : static_cast<Accum<T>>(x[i]); }, deps, VecAligned(x));
+	}
+
+	/* DeviceVector forms, over the shorter of two operands */
+
+	template <typename T>
+	sycl::event axpy(T alpha, const DeviceVector<T>& x, DeviceVector<T>& y, const std::vector<sycl::event>& deps = {}) {
+		return axpy(y.Queue(), std::min(x.Size(), y.Size()), alpha, x.Data(), y.Data(), deps);
+	}
+
+	template <typename T>
+	sycl::event scal(T alpha, DeviceVector<T>& x, const std::vector<sycl::event>& deps = {}) {
+		return scal(x.Queue(), x.Size(), alpha, x.Data(), deps);
+	}
+
+	template <typename T>
+	sycl::event copy(const DeviceVector<T>& x, DeviceVector<T>& y, const std::vector<sycl::event>& deps = {}) {
+		return copy(y.Queue(), std::min(x.Size(), y.Size()), x.Data(), y.Data(), deps);
+	}
+
+	template <typename T>
+	Accum<T> dot(const DeviceVector<T>& x, const DeviceVector<T>& y, const std::vector<sycl::event>& deps = {}) {
+		return dot(x.Queue(), std::min(x.Size(), y.Size()), x.Data(), y.Data(), deps);
+	}
+
+	template <typename T>
+	Real<T> nrm2(const DeviceVector<T>& x, const std::vector<sycl::event>& deps = {}) {
+		return nrm2(x.Queue(), x.Size(), x.Data(), deps);
+	}
+
+	template <typename T>
+	Accum<T> asum(const DeviceVector<T>& x, const std::vector<sycl::event>& deps = {}) {
+		return asum(x.Queue(), x.Size(), x.Data(), deps);
+	}
+}
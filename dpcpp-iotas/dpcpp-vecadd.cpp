@@ -3,21 +3,26 @@ DataParallel Addition of two Vectors using device buffers.
 */
 
 #include <CL/sycl.hpp>
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <chrono>
-#include <thread>
+#include "philox.h"
+#include "blas1.h"
+#include "reduction.h"
+#include "expression.h"
+#include "streaming.h"
 
-using namespace std::this_thread;
 using namespace std::chrono;
 using namespace sycl;
 
 // Define array_size
 constexpr size_t array_size = 128000000;
 
-// Function to initialize array with the same value as its index
-void InitializeArray(std::vector<int> &a) {
-	for (size_t i = 0; i < a.size(); i++) a[i] = i;
+// Function to initialize array with reproducible random values, on all host threads
+void InitializeArray(std::vector<int> &a, uint32_t stream) {
+	nanoblas::PhiloxFillHost(nanoblas::Philox(1234, stream), a.data(), a.size(),
+		[](uint32_t word) { return int(word % 1000); });
 }
 
 // Create an asynchronous Exception Handler for sycl
@@ -76,6 +81,195 @@ void VectorAddParallel(queue &q,
 	*/
 }
 
+// Bandwidth of one blocking call that moves `bytes`
+template <typename Call>
+double GBps(double bytes, Call call) {
+	auto start = high_resolution_clock::now();
+	call();
+	auto end = high_resolution_clock::now();
+	return bytes * 1e-9 / duration<double>(end - start).count();
+}
+
+/*
+BLAS-1 chain on persistent device vectors: uploaded once, every op runs on device memory.
+Each op is timed on its own and reported against the bytes it has to move.
+*/
+void Blas1Parallel(queue& q, const std::vector<int>& x_host, const std::vector<int>& y_host) {
+	iotas::DeviceVector<int> x(q, x_host), y(q, y_host), z(q, x_host.size());
+	const double n = static_cast<double>(x.Size()) * sizeof(int);
+	int64_t dot = 0, asum = 0;
+	double nrm2 = 0;
+
+	/* First calls pay JIT compilation */
+	iotas::copy(x, z).wait();
+	iotas::dot(x, y);
+
+	std::cout << "BLAS-1 on " << x.Size() << " ints\n";
+	std::cout << "\tcopy: " << GBps(2 * n, [&]() { iotas::copy(x, z).wait(); }) << " GB/s\n";
+	std::cout << "\tscal: " << GBps(2 * n, [&]() { iotas::scal(3, z).wait(); }) << " GB/s\n";
+	std::cout << "\taxpy: " << GBps(3 * n, [&]() { iotas::axpy(2, x, z).wait(); }) << " GB/s\n";
+	std::cout << "\tdot : " << GBps(2 * n, [&]() { dot = iotas::dot(x, y); }) << " GB/s\n";
+	std::cout << "\tnrm2: " << GBps(n, [&]() { nrm2 = iotas::nrm2(x); }) << " GB/s\n";
+	std::cout << "\tasum: " << GBps(n, [&]() { asum = iotas::asum(x); }) << " GB/s\n";
+
+	/* z = 2x + 3x = 5x */
+	std::vector<int> z_host(z.Size());
+	z.CopyToHost(z_host.data()).wait();
+	int64_t dot_ref = 0, asum_ref = 0;
+	bool match = true;
+	for (size_t i = 0; i < x_host.size(); i++) {
+		dot_ref += static_cast<int64_t>(x_host[i]) * y_host[i];
+		asum_ref += std::abs(x_host[i]);
+		match = match && z_host[i] == 5 * x_host[i];
+	}
+	if (!match || dot != dot_ref || asum != asum_ref)
+		std::cout << "BLAS-1 mismatch: dot " << dot << " != " << dot_ref << " or asum " << asum << " != " << asum_ref << "\n";
+	else
+		std::cout << "BLAS-1 results match, nrm2 = " << nrm2 << "\n";
+}
+
+/*
+Sum, min, max and argmax of a device vector with the hierarchical engine, against the
+plain way: a parallel_for producing the terms, a copy back and a serial host sum.
+*/
+void ReductionParallel(queue& q, const std::vector<int>& x_host) {
+	const size_t n = x_host.size();
+	iotas::DeviceVector<int> x(q, x_host);
+	const int* xp = x.Data();
+	auto wide = [=](size_t i) { return int64_t(xp[i]); };
+
+	/* Baseline */
+	int64_t* terms = malloc_device<int64_t>(n, q);
+	std::vector<int64_t> terms_host(n);
+	int64_t baseline = 0;
+	auto start = high_resolution_clock::now();
+	q.parallel_for(range<1>{ n }, [=](id<1> i) { terms[i] = xp[i]; }).wait();
+	q.memcpy(terms_host.data(), terms, n * sizeof(int64_t)).wait();
+	for (int64_t t : terms_host)
+		baseline += t;
+	auto end = high_resolution_clock::now();
+	free(terms, q);
+	const double baseline_s = duration<double>(end - start).count();
+
+	/* Engine. First call pays JIT compilation */
+	iotas::Reduce<int64_t>(q, n, wide, iotas::SumOp<int64_t>());
+	start = high_resolution_clock::now();
+	const int64_t sum = iotas::Reduce<int64_t>(q, n, wide, iotas::SumOp<int64_t>());
+	end = high_resolution_clock::now();
+	const double engine_s = duration<double>(end - start).count();
+	const int lo = iotas::Min(q, xp, n), hi = iotas::Max(q, xp, n);
+	const iotas::ValueIndex<int> top = iotas::ArgMax(q, xp, n);
+
+	std::cout << "Reduction of " << n << " ints\n"
+		<< "\tparallel_for + host sum: " << baseline_s << "s (" << n * sizeof(int) * 1e-9 / baseline_s << " GB/s)\n"
+		<< "\thierarchical           : " << engine_s << "s (" << n * sizeof(int) * 1e-9 / engine_s << " GB/s)\n";
+
+	const auto minmax = std::minmax_element(x_host.begin(), x_host.end());
+	const size_t top_ref = std::max_element(x_host.begin(), x_host.end()) - x_host.begin();
+	if (sum != baseline || lo != *minmax.first || hi != *minmax.second || top.Index != top_ref)
+		std::cout << "Reduction mismatch: sum " << sum << " != " << baseline << ", min " << lo << ", max " << hi
+			<< ", argmax " << top.Index << " != " << top_ref << "\n";
+	else
+		std::cout << "Reductions match: sum " << sum << ", min " << lo << ", max " << hi << " first at [" << top.Index << "]\n";
+}
+
+/*
+z = 3 * x + y - w as three BLAS-1 kernels (copy, axpy, axpy) and as one fused expression.
+With w = x + y, z = 2 * x.
+*/
+void FusedParallel(queue& q, const std::vector<int>& x_host, const std::vector<int>& y_host, const std::vector<int>& w_host) {
+	iotas::DeviceVector<int> x(q, x_host), y(q, y_host), w(q, w_host), z(q, x_host.size());
+	const double n = static_cast<double>(x.Size()) * sizeof(int);
+
+	/* First calls pay JIT compilation */
+	iotas::copy(y, z).wait();
+	iotas::axpy(3, x, z).wait();
+	z = 3 * x + y - w;
+
+	/* Unfused: copy 2 passes, each axpy 3: 8 passes over memory. Fused: 4 */
+	const double unfused = GBps(8 * n, [&]() {
+		sycl::event e = iotas::copy(y, z);
+		e = iotas::axpy(3, x, z, { e });
+		iotas::axpy(-1, w, z, { e }).wait();
+	});
+	const double fused = GBps(4 * n, [&]() { z = 3 * x + y - w; });
+	std::cout << "z = 3x + y - w on " << x.Size() << " ints\n"
+		<< "\t3 kernels: " << unfused * 4 / 8 << " GB/s effective, " << unfused << " GB/s moved\n"
+		<< "\tfused    : " << fused << " GB/s\n";
+
+	std::vector<int> z_host(z.Size());
+	z.CopyToHost(z_host.data()).wait();
+	for (size_t i = 0; i < z_host.size(); i++) {
+		if (z_host[i] != 2 * x_host[i]) {
+			std::cout << "Fused mismatch at [" << i << "]: " << z_host[i] << " != " << 2 * x_host[i] << "\n";
+			return;
+		}
+	}
+	std::cout << "Fused results match.\n";
+}
+
+/*
+x + y for host arrays, end to end (host -> device -> host), three ways:
+	memcpy:   the copies alone, back to back. What a non-overlapped add costs at best
+	bulk:     whole arrays up, one kernel, whole result down
+	streamed: chunks of x, y up, add and result down overlapped (streaming.h)
+All three run on pinned host memory (sycl::malloc_host): copies from pageable memory are
+staged by the runtime and hardly overlap anything. Streamed from the std::vectors is shown
+for comparison. GB/s counts the 3 * n elements that cross the bus.
+*/
+void VectorAddStreaming(queue& q, const std::vector<int>& x_host, const std::vector<int>& y_host, const std::vector<int>& expected) {
+	const size_t n = x_host.size();
+	const double bytes = 3.0 * n * sizeof(int);
+	auto add = [](auto a, auto b) { return a + b; };
+
+	int* x = sycl::malloc_host<int>(n, q);
+	int* y = sycl::malloc_host<int>(n, q);
+	int* sum = sycl::malloc_host<int>(n, q);
+	if (x == nullptr || y == nullptr || sum == nullptr) {
+		std::cout << "[ERROR] Failed to allocate " << 3 * n * sizeof(int) / 1024 / 1024 << " MB of pinned host memory.\n";
+		sycl::free(x, q);
+		sycl::free(y, q);
+		sycl::free(sum, q);
+		return;
+	}
+	std::copy(x_host.begin(), x_host.end(), x);
+	std::copy(y_host.begin(), y_host.end(), y);
+
+	iotas::DeviceVector<int> dx(q, n), dy(q, n), dsum(q, n);
+	const double memcpy_gbps = GBps(bytes, [&]() {
+		dx.CopyFromHost(x).wait();
+		dy.CopyFromHost(y).wait();
+		dsum.CopyToHost(sum).wait();
+	});
+	const double bulk_gbps = GBps(bytes, [&]() {
+		sycl::event ex = dx.CopyFromHost(x);
+		sycl::event ey = dy.CopyFromHost(y);
+		sycl::event e = iotas::Assign(dsum, dx + dy, { ex, ey });
+		dsum.CopyToHost(sum, { e }).wait();
+	});
+
+	/* First call pays JIT compilation */
+	iotas::StreamBinary(q, x, y, sum, std::min<size_t>(n, iotas::DEFAULT_STREAM_CHUNK), add);
+	std::fill(sum, sum + n, 0);
+	const double streamed_gbps = GBps(bytes, [&]() { iotas::StreamBinary(q, x, y, sum, n, add); });
+	const bool match = std::equal(sum, sum + n, expected.begin());
+
+	std::vector<int> pageable_sum(n);
+	const double pageable_gbps = GBps(bytes, [&]() { iotas::StreamBinary(q, x_host.data(), y_host.data(), pageable_sum.data(), n, add); });
+
+	std::cout << "x + y from pinned host memory, " << n << " ints\n"
+		<< "\tmemcpy  : " << memcpy_gbps << " GB/s\n"
+		<< "\tbulk    : " << bulk_gbps << " GB/s\n"
+		<< "\tstreamed: " << streamed_gbps << " GB/s (" << iotas::DEFAULT_STREAM_DEPTH << " chunks of "
+		<< iotas::DEFAULT_STREAM_CHUNK << " in flight)\n"
+		<< "\tstreamed from pageable std::vector: " << pageable_gbps << " GB/s\n";
+	std::cout << (match && pageable_sum == expected ? "Streamed results match.\n" : "Streamed results do not match.\n");
+
+	sycl::free(x, q);
+	sycl::free(y, q);
+	sycl::free(sum, q);
+}
+
 int main() {
 	default_selector d_selector;
 	std::vector<int> a(array_size), b(array_size), sequential(array_size), parallel(array_size);
@@ -83,11 +277,9 @@ int main() {
 	/*
 	Init arrays. They are passed by reference
 	*/
-	InitializeArray(a);
-	InitializeArray(b);
+	InitializeArray(a, 0);
+	InitializeArray(b, 1);
 
-	std::cout << "Will start after 10 seconds...\n";
-	sleep_for(seconds(10));
 	/*
 	Do the sequential, which is supposed to be slow
 	*/
@@ -112,6 +304,10 @@ int main() {
 				  << q.get_device().get_info<info::device::name>() << "\n";
 		std::cout << "Vector size: " << a.size() << "\n";
 		VectorAddParallel(q, a, b, parallel);
+		Blas1Parallel(q, a, b);
+		ReductionParallel(q, a);
+		FusedParallel(q, a, b, sequential);
+		VectorAddStreaming(q, a, b, sequential);
 	}
 	catch (std::exception const& e) {
 		std::cout << "Exception while creating Queue. Terminating...\n";
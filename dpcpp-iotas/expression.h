@@ -0,0 +1,150 @@
+#pragma once
+/*
+Lazy elementwise expressions on DeviceVectors.
+Arithmetic on vectors and scalars builds a tree of small value types instead of running
+anything. Assigning the tree to a vector compiles it into one grid-stride kernel (blas1.h)
+that reads each input once and writes the output once:
+	z = a * x + y - w;		// one pass over x, y, w, z instead of three kernels
+The tree is captured by value in the kernel, leaves hold device pointers. Vectors are
+read WIDTH elements at a time as sycl::vec, like the BLAS-1 kernels.
+*/
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "blas1.h"
+
+namespace iotas {
+	template <typename T>
+	struct VectorRef : Expression {
+		// Leaf: a device vector
+		using Value = T;
+		const T* Data;
+		size_t N;
+
+		VectorRef(const T* data, size_t n) : Data(data), N(n) {}
+
+		T operator()(size_t i) const { return Data[i]; }
+		template <int W>
+		sycl::vec<T, W> Load(size_t v) const { return reinterpret_cast<const sycl::vec<T, W>*>(Data)[v]; }
+		size_t Size() const { return N; }
+	};
+
+	template <typename T>
+	struct Scalar : Expression {
+		// Leaf: the same value everywhere, any length
+		using Value = T;
+		T X;
+
+		explicit Scalar(T x) : X(x) {}
+
+		T operator()(size_t) const { return X; }
+		template <int W>
+		sycl::vec<T, W> Load(size_t) const { return sycl::vec<T, W>(X); }
+		size_t Size() const { return std::numeric_limits<size_t>::max(); }
+	};
+
+	/* Operations, on scalars and on sycl::vec alike */
+	struct AddOp { template <typename A> static A Apply(const A& a, const A& b) { return a + b; } };
+	struct SubOp { template <typename A> static A Apply(const A& a, const A& b) { return a - b; } };
+	struct MulOp { template <typename A> static A Apply(const A& a, const A& b) { return a * b; } };
+	struct DivOp { template <typename A> static A Apply(const A& a, const A& b) { return a / b; } };
+
+	template <typename L, typename R, typename Op>
+	struct Binary : Expression {
+		using Value = typename L::Value;
+		L Left;
+		R Right;
+
+		Binary(const L& left, const R& right) : Left(left), Right(right) {}
+
+		Value operator()(size_t i) const { return Op::Apply(Left(i), Right(i)); }
+		template <int W>
+		sycl::vec<Value, W> Load(size_t v) const { return Op::Apply(Left.template Load<W>(v), Right.template Load<W>(v)); }
+		size_t Size() const { return std::min(Left.Size(), Right.Size()); }
+	};
+
+	template <typename E>
+	struct Negate : Expression {
+		using Value = typename E::Value;
+		E Inner;
+
+		explicit Negate(const E& inner) : Inner(inner) {}
+
+		Value operator()(size_t i) const { return -Inner(i); }
+		template <int W>
+		sycl::vec<Value, W> Load(size_t v) const { return sycl::vec<Value, W>(Value(0)) - Inner.template Load<W>(v); }
+		size_t Size() const { return Inner.Size(); }
+	};
+
+	/* Operands: expressions as they are, vectors as leaves */
+
+	template <typename E, typename = std::enable_if_t<std::is_base_of<Expression, E>::value>>
+	const E& Operand(const E& e) { return e; }
+
+	template <typename T>
+	VectorRef<T> Operand(const DeviceVector<T>& x) { return { x.Data(), x.Size() }; }
+
+	template <typename X>
+	struct IsOperand : std::is_base_of<Expression, X> {};
+	template <typename T>
+	struct IsOperand<DeviceVector<T>> : std::true_type {};
+
+	template <typename X>
+	using OperandType = std::decay_t<decltype(Operand(std::declval<const X&>()))>;
+
+	// Scalars take the element type of the other side, so vector ops never mix types.
+	// A floating point scalar would be truncated on int vectors (0.5 * x is 0 * x): rejected
+	template <typename X, typename S>
+	Scalar<typename OperandType<X>::Value> ScalarLike(S s) {
+		using T = typename OperandType<X>::Value;
+		static_assert(!(std::is_integral<T>::value && std::is_floating_point<S>::value), "Floating point scalar in an integer expression");
+		return Scalar<T>(static_cast<T>(s));
+	}
+
+#define IOTAS_BINARY_OPERATOR(op, Op)																				\
+	template <typename L, typename R, typename = std::enable_if_t<IsOperand<L>::value && IsOperand<R>::value>>		\
+	Binary<OperandType<L>, OperandType<R>, Op> operator op(const L& l, const R& r) {								\
+		return { Operand(l), Operand(r) };																			\
+	}																												\
+	template <typename L, typename S, typename = std::enable_if_t<IsOperand<L>::value && std::is_arithmetic<S>::value>, typename = void>	\
+	Binary<OperandType<L>, Scalar<typename OperandType<L>::Value>, Op> operator op(const L& l, S s) {				\
+		return { Operand(l), ScalarLike<L>(s) };																	\
+	}																												\
+	template <typename S, typename R, typename = std::enable_if_t<std::is_arithmetic<S>::value && IsOperand<R>::value>, typename = void, typename = void>	\
+	Binary<Scalar<typename OperandType<R>::Value>, OperandType<R>, Op> operator op(S s, const R& r) {				\
+		return { ScalarLike<R>(s), Operand(r) };																	\
+	}
+
+	IOTAS_BINARY_OPERATOR(+, AddOp)
+	IOTAS_BINARY_OPERATOR(-, SubOp)
+	IOTAS_BINARY_OPERATOR(*, MulOp)
+	IOTAS_BINARY_OPERATOR(/, DivOp)
+#undef IOTAS_BINARY_OPERATOR
+
+	template <typename E, typename = std::enable_if_t<IsOperand<E>::value>>
+	Negate<OperandType<E>> operator-(const E& e) {
+		return Negate<OperandType<E>>(Operand(e));
+	}
+
+	//-----------------------------------------------------------------------------
+	// dst = e in one kernel. Does not wait. dst may appear in e: element i is only
+	// read by the work-item that writes it.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename E>
+	sycl::event Assign(DeviceVector<T>& dst, const E& e, const std::vector<sycl::event>& deps = {}) {
+		static_assert(std::is_same<typename E::Value, T>::value, "Expression and destination element types differ");
+		if (e.Size() != std::numeric_limits<size_t>::max() && e.Size() != dst.Size()) {
+			std::cout << "[ERROR] Assign: expression of " << e.Size() << " elements into a vector of " << dst.Size() << ".\n";
+			return sycl::event();
+		}
+		using V = sycl::vec<T, VecWidth<T>()>;
+		T* out = dst.Data();
+		V* outv = reinterpret_cast<V*>(out);
+		return Elementwise<T>(dst.Queue(), dst.Size(),
+			[=](size_t v) { outv[v] = e.template Load<VecWidth<T>()>(v); },
+			[=](size_t i) { out[i] = e(i); }, deps);
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+/*
+Hierarchical reduction of n terms under any associative, commutative operation:
+	1. Work-item: grid-stride loop folds its share of the terms in registers
+	2. Sub-group: butterfly of select_from_group exchanges, no memory traffic
+	3. Work-group: sub-group results combined by a tree in local memory
+	4. Final pass: one work-group folds the per-group partials into the result
+Everything stays on the device: the async form writes the result to a USM pointer
+and returns an event, so reductions chain with other kernels without a host round trip.
+
+Operations are functors with Identity() and operator(). Terms are visited in grid-stride
+order, not sequence order. Sum, Min, Max and ArgMax are provided.
+Sub-group and work-group sizes are assumed to be powers of two.
+*/
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace iotas {
+	constexpr size_t GROUPS_PER_CU = 8;		// Enough resident groups to hide memory latency
+	constexpr size_t MAX_GROUP_SIZE = 256;
+
+	struct Grid {
+		size_t Groups, GroupSize;
+
+		size_t Items() const { return Groups * GroupSize; }
+		sycl::nd_range<1> Range() const { return { Items(), GroupSize }; }
+	};
+
+	// Grid for `work` independent units, never more than the device keeps busy
+	inline Grid GridFor(const sycl::queue& q, size_t work) {
+		const sycl::device device = q.get_device();
+		const size_t groupSize = std::min<size_t>(MAX_GROUP_SIZE, device.get_info<sycl::info::device::max_work_group_size>());
+		const size_t maxGroups = GROUPS_PER_CU * device.get_info<sycl::info::device::max_compute_units>();
+		const size_t groups = std::max<size_t>(1, std::min(maxGroups, (work + groupSize - 1) / groupSize));
+		return { groups, groupSize };
+	}
+
+	template <typename T>
+	struct SumOp {
+		T Identity() const { return T(0); }
+		T operator()(const T& a, const T& b) const { return a + b; }
+	};
+
+	// Bounds of T, infinities included: identities of Min and Max that data can not beat
+	template <typename T>
+	constexpr T Top() { return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max(); }
+
+	template <typename T>
+	constexpr T Bottom() { return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest(); }
+
+	template <typename T>
+	struct MinOp {
+		T Identity() const { return Top<T>(); }
+		T operator()(const T& a, const T& b) const { return b < a ? b : a; }
+	};
+
+	template <typename T>
+	struct MaxOp {
+		T Identity() const { return Bottom<T>(); }
+		T operator()(const T& a, const T& b) const { return a < b ? b : a; }
+	};
+
+	template <typename T>
+	struct ValueIndex {
+		T Value;
+		size_t Index;
+	};
+
+	// Largest value, first index among equals: the result does not depend on the grid
+	template <typename T>
+	struct ArgMaxOp {
+		ValueIndex<T> Identity() const { return { Bottom<T>(), std::numeric_limits<size_t>::max() }; }
+		ValueIndex<T> operator()(const ValueIndex<T>& a, const ValueIndex<T>& b) const {
+			return (b.Value > a.Value || (b.Value == a.Value && b.Index < a.Index)) ? b : a;
+		}
+	};
+
+	//-----------------------------------------------------------------------------
+	// One level of the hierarchy: group g of `grid` folds terms map(i), i in [0, n),
+	// and writes its partial to out[g]. Terms are visited in grid-stride order.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename Map, typename Op>
+	sycl::event ReduceBlocks(sycl::queue& q, const Grid& grid, size_t n, Map map, Op op, T* out,
+		const std::vector<sycl::event>& deps) {
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			sycl::accessor<T, 1, sycl::access::mode::read_write, sycl::access::target::local> scratch(sycl::range<1>{ grid.GroupSize }, h);
+			h.parallel_for(grid.Range(), [=](sycl::nd_item<1> item) {
+				const size_t lid = item.get_local_id(0);
+				const size_t stride = item.get_global_range(0);
+
+				/* 1. Registers */
+				T acc = op.Identity();
+				for (size_t i = item.get_global_id(0); i < n; i += stride)
+					acc = op(acc, map(i));
+
+				/* 2. Sub-group butterfly: every lane ends with the sub-group's value */
+				sycl::sub_group sg = item.get_sub_group();
+				const size_t lane = sg.get_local_id()[0];
+				for (size_t offset = sg.get_local_range()[0] / 2; offset > 0; offset /= 2)
+					acc = op(acc, sycl::select_from_group(sg, acc, lane ^ offset));
+
+				/* 3. Work-group tree over the sub-group results */
+				scratch[lid] = op.Identity();
+				item.barrier(sycl::access::fence_space::local_space);
+				if (lane == 0)
+					scratch[sg.get_group_id()[0]] = acc;
+				item.barrier(sycl::access::fence_space::local_space);
+				for (size_t s = grid.GroupSize / 2; s > 0; s /= 2) {
+					if (lid < s)
+						scratch[lid] = op(scratch[lid], scratch[lid + s]);
+					item.barrier(sycl::access::fence_space::local_space);
+				}
+				if (lid == 0)
+					out[item.get_group(0)] = scratch[0];
+			});
+		});
+	}
+
+	//-----------------------------------------------------------------------------
+	// result[0] = op over map(i) for i in [0, n). Two launches, the second over the
+	// per-group partials with a single work-group. Does not wait.
+	// result must be USM visible to the device. Identity() if n == 0.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename Map, typename Op>
+	sycl::event ReduceAsync(sycl::queue& q, size_t n, Map map, Op op, T* result,
+		const std::vector<sycl::event>& deps = {}) {
+		const Grid grid = GridFor(q, n);
+		if (grid.Groups == 1)
+			return ReduceBlocks(q, grid, n, map, op, result, deps);
+
+		T* partials = sycl::malloc_device<T>(grid.Groups, q);
+		sycl::event blocks = ReduceBlocks(q, grid, n, map, op, partials, deps);
+		sycl::event last = ReduceBlocks(q, Grid{ 1, grid.GroupSize }, grid.Groups,
+			[=](size_t g) { return partials[g]; }, op, result, { blocks });
+		/* Partials are released once the final pass is done with them */
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(last);
+			h.host_task([=]() { sycl::free(partials, q); });
+		});
+	}
+
+	// Blocking form: the reduced value
+	template <typename T, typename Map, typename Op>
+	T Reduce(sycl::queue& q, size_t n, Map map, Op op, const std::vector<sycl::event>& deps = {}) {
+		T* result = sycl::malloc_shared<T>(1, q);
+		ReduceAsync(q, n, map, op, result, deps).wait();
+		const T value = *result;
+		sycl::free(result, q);
+		return value;
+	}
+
+	/* Common reductions of a device array */
+
+	template <typename T>
+	T Sum(sycl::queue& q, const T* x, size_t n, const std::vector<sycl::event>& deps = {}) {
+		return Reduce<T>(q, n, [=](size_t i) { return x[i]; }, SumOp<T>(), deps);
+	}
+
+	template <typename T>
+	T Min(sycl::queue& q, const T* x, size_t n, const std::vector<sycl::event>& deps = {}) {
+		return Reduce<T>(q, n, [=](size_t i) { return x[i]; }, MinOp<T>(), deps);
+	}
+
+	template <typename T>
+	T Max(sycl::queue& q, const T* x, size_t n, const std::vector<sycl::event>& deps = {}) {
+		return Reduce<T>(q, n, [=](size_t i) { return x[i]; }, MaxOp<T>(), deps);
+	}
+
+	template <typename T>
+	ValueIndex<T> ArgMax(sycl::queue& q, const T* x, size_t n, const std::vector<sycl::event>& deps = {}) {
+		return Reduce<ValueIndex<T>>(q, n, [=](size_t i) { return ValueIndex<T>{ x[i], i }; }, ArgMaxOp<T>(), deps);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+Streamed elementwise ops on host arrays of any size: out[i] = op(x[i], y[i]).
+The arrays are split into chunks and `depth` chunks are in flight at once, each in its
+own slot of device buffers. Chunk k's host-to-device copies, kernel and device-to-host
+copy are chained by events only, so while chunk k computes, chunk k+1 is uploading and
+chunk k-1 is downloading. Device memory used: depth * 3 chunks, whatever n is.
+
+Copies from pageable memory (std::vector) are staged by the runtime. Host arrays from
+sycl::malloc_host are pinned and let the copy engines run at full speed.
+*/
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <vector>
+#include "blas1.h"
+
+namespace iotas {
+	constexpr size_t DEFAULT_STREAM_CHUNK = 8 << 20;	// Elements per chunk
+	constexpr size_t DEFAULT_STREAM_DEPTH = 2;			// Chunks in flight
+
+	//-----------------------------------------------------------------------------
+	// op(a, b) must accept both T and sycl::vec<T, W> (eg: a generic lambda).
+	// Chunks are multiples of the vector width, so every chunk but the last is
+	// vectorized end to end. Blocking: returns once out is complete on the host.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename Op>
+	void StreamBinary(sycl::queue& q, const T* x, const T* y, T* out, size_t n, Op op,
+		size_t chunk = DEFAULT_STREAM_CHUNK, size_t depth = DEFAULT_STREAM_DEPTH) {
+		constexpr int W = VecWidth<T>();
+		using V = sycl::vec<T, W>;
+		chunk = std::max<size_t>(W, std::min(chunk, n) / W * W);
+		depth = std::max<size_t>(1, depth);
+
+		std::vector<DeviceVector<T>> dx, dy, dout;
+		for (size_t s = 0; s < depth; s++) {
+			dx.emplace_back(q, chunk);
+			dy.emplace_back(q, chunk);
+			dout.emplace_back(q, chunk);
+		}
+
+		/* Per slot: last kernel (reads dx, dy) and last download (reads dout) */
+		std::vector<sycl::event> computed(depth), downloaded(depth);
+		for (size_t k = 0, begin = 0; begin < n; k++, begin += chunk) {
+			const size_t s = k % depth;
+			const size_t len = std::min(chunk, n - begin);
+			const size_t bytes = len * sizeof(T);
+
+			sycl::event upX = q.memcpy(dx[s].Data(), x + begin, bytes, { computed[s] });
+			sycl::event upY = q.memcpy(dy[s].Data(), y + begin, bytes, { computed[s] });
+
+			const T* a = dx[s].Data();
+			const T* b = dy[s].Data();
+			T* c = dout[s].Data();
+			const V* av = reinterpret_cast<const V*>(a);
+			const V* bv = reinterpret_cast<const V*>(b);
+			V* cv = reinterpret_cast<V*>(c);
+			computed[s] = Elementwise<T>(q, len,
+				[=](size_t v) { cv[v] = op(av[v], bv[v]); },
+				[=](size_t i) { c[i] = op(a[i], b[i]); }, { upX, upY, downloaded[s] });
+
+			downloaded[s] = q.memcpy(out + begin, c, bytes, { computed[s] });
+		}
+		for (sycl::event& e : downloaded)
+			e.wait();
+	}
+}
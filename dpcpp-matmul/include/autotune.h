@@ -0,0 +1,130 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include "matrix.h"
+#include "registry.h"
+#include "roofline.h"
+
+namespace nanoblas {
+	class Autotuner {
+		// Benchmarks every registered configuration that fits the device and
+		// remembers the fastest one per (device name, shape bucket) in a text file:
+		//	<device name>\t<shape bucket>\t<config name>
+	private:
+		std::string m_CachePath;
+		std::map<std::string, std::string> m_Cache;
+
+		static std::string Key(const std::string& device, const std::string& bucket) {
+			return device + "\t" + bucket;
+		}
+
+		static size_t RoundUpPow2(size_t x) {
+			size_t p = 1;
+			while (p < x) p <<= 1;
+			return p;
+		}
+
+	public:
+		explicit Autotuner(const std::string& cachePath = "autotune.cache")
+			: m_CachePath(cachePath)
+		{
+			Load();
+		}
+
+		// Shapes are grouped by rounding every dimension up to a power of two
+		static std::string ShapeBucket(size_t M, size_t N, size_t P) {
+			return std::to_string(RoundUpPow2(M)) + "x" + std::to_string(RoundUpPow2(N)) + "x" + std::to_string(RoundUpPow2(P));
+		}
+
+		// Discard configurations the device cannot launch
+		static bool Fits(const GemmConfig& config, const sycl::device& device) {
+			auto wgroup_size = device.get_info<sycl::info::device::max_work_group_size>();
+			auto local_mem_size = device.get_info<sycl::info::device::local_mem_size>();
+			if (config.Kernel == KernelId::SubGroup) {
+				auto sg_sizes = device.get_info<sycl::info::device::sub_group_sizes>();
+				if (std::find(sg_sizes.begin(), sg_sizes.end(), config.TS) == sg_sizes.end())
+					return false;
+			}
+			return config.WorkGroupSize() <= wgroup_size
+				&& config.LocalMemBytes() <= local_mem_size;
+		}
+
+		void Load() {
+			std::ifstream in(m_CachePath);
+			std::string line;
+			while (std::getline(in, line)) {
+				size_t first = line.find('\t');
+				size_t last = line.rfind('\t');
+				if (first == std::string::npos || first == last)
+					continue;
+				m_Cache[line.substr(0, last)] = line.substr(last + 1);
+			}
+		}
+
+		void Save() const {
+			std::ofstream out(m_CachePath);
+			for (const auto& kv : m_Cache)
+				out << kv.first << "\t" << kv.second << "\n";
+		}
+
+		// Cached winner for this device and shape, nullptr when not tuned yet
+		const GemmEntry* Select(Context& ctx, size_t M, size_t N, size_t P) const {
+			const std::string device = ctx.Device().get_info<sycl::info::device::name>();
+			auto it = m_Cache.find(Key(device, ShapeBucket(M, N, P)));
+			if (it == m_Cache.end())
+				return nullptr;
+			const GemmEntry* entry = Registry::Get().Find(it->second);
+			if (entry == nullptr || !Fits(entry->Config, ctx.Device()))
+				return nullptr;
+			return entry;
+		}
+
+		// Sweep all fitting configurations on (a, b, c), cache and return the fastest
+		const GemmEntry& Tune(Context& ctx, const Matrix& a, const Matrix& b, Matrix& c, int repetitions = 3) {
+			PROFILE_FUNCTION(Time);
+			const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+			const sycl::device device = ctx.Device();
+
+			const GemmEntry* best = nullptr;
+			double bestTime = 0;
+			for (const GemmEntry& entry : Registry::Get().Entries()) {
+				if (!Fits(entry.Config, device)) {
+					std::cout << "[AUTOTUNE] Skipping " << entry.Config.Name() << "\n";
+					continue;
+				}
+				// First run pays the JIT compilation
+				entry(ctx, a, b, c);
+
+				// Kernel event time, so scope output and submission overhead do not weigh in
+				double t_Seconds = 0;
+				for (int r = 0; r < repetitions; r++) {
+					const double t = KernelSeconds([&]() { entry(ctx, a, b, c); });
+					t_Seconds = (r == 0 || t < t_Seconds) ? t : t_Seconds;
+				}
+				std::cout << "[AUTOTUNE] " << entry.Config.Name() << ": " << t_Seconds << "s\n";
+
+				if (best == nullptr || t_Seconds < bestTime) {
+					best = &entry;
+					bestTime = t_Seconds;
+				}
+			}
+
+			// The naive kernel always fits, so there is always a winner
+			const std::string name = device.get_info<sycl::info::device::name>();
+			m_Cache[Key(name, ShapeBucket(M, N, P))] = best->Config.Name();
+			Save();
+			std::cout << "[AUTOTUNE] Best for " << ShapeBucket(M, N, P) << ": " << best->Config.Name() << "\n";
+			return *best;
+		}
+
+		// Cached winner if there is one, else tune now
+		const GemmEntry& SelectOrTune(Context& ctx, const Matrix& a, const Matrix& b, Matrix& c) {
+			const GemmEntry* entry = Select(ctx, a.Rows(), a.Cols(), b.Cols());
+			return entry != nullptr ? *entry : Tune(ctx, a, b, c);
+		}
+	};
+}
@@ -3,26 +3,52 @@
 	TODO:
 	[x]: Use namespaces for timing/CL functions separately
 */
+#include <CL/sycl.hpp>
 #include <chrono>
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "settings.h"
 
-#define PROFILING 1
+#ifndef PROFILING
+#define PROFILING 1 // Define as 0 before including to compile the scope timers out (eg: the benchmark driver)
+#endif
 #if PROFILING
-#define PROFILE_SCOPE(name, mode) pfr::InstrumentationTimer timer##__LINE__(name, mode) // Same timernames in one fn: append LINE_NUMBER!!!
+#define PROFILE_SCOPE(name, mode) pfr::InstrumentationTimer timer##__LINE__(name, pfr::Report::mode) // mode: None, Time or Gflops. Same timernames in one fn: append LINE_NUMBER!!!
 #define PROFILE_FUNCTION(mode) PROFILE_SCOPE(__FUNCSIG__, mode) // __FUNCTION__ only fn name, __FUNCSIG__ shows overloads
+#define PROFILE_EVENT(e) pfr::Instrumentor::Get().WriteDeviceEvent(__FUNCSIG__, e) // Completed sycl::event onto the device track
+#define PROFILE_TRANSFER(e) pfr::Instrumentor::Get().WriteDeviceEvent(__FUNCSIG__, e, true) // Same, for copies: not counted as kernel time
+#define PROFILE_CALIBRATE(q) pfr::Instrumentor::Get().CalibrateClock(q) // Once per profiling queue: maps its device clock onto the host clock
+#define PROFILE_FLOPS(flops) pfr::Instrumentor::Get().AddFlops(flops) // Work done, for the GFLOPS of the enclosing Gflops scopes
+#else
+#define PROFILE_SCOPE(name, mode)
+#define PROFILE_FUNCTION(mode)
+#define PROFILE_EVENT(e)
+#define PROFILE_TRANSFER(e)
+#define PROFILE_CALIBRATE(q)
+#define PROFILE_FLOPS(flops)
 #endif
 
 #define GIGAFLOPS(x) (2*(pow(SIZE, 3))*1e-9 / x)
+#define GEMM_GIGAFLOPS(M, N, P, x) (2.0 * (M) * (N) * (P) * 1e-9 / (x))	// Any shape: C[M, P] = A[M, N] * B[N, P]
 
 namespace pfr {
+	// What a scope prints when Instrumentor::EchoScopes is on. Every scope is traced regardless
+	enum class Report { None, Time, Gflops };
+
 	struct ProfileResult {
-		// Each profile entity will have Name, Starttime, Endtime
-		std::string Name;
+		// Each profile entity will have Name, Starttime, Endtime.
+		// Name is kept by pointer (eg: __FUNCSIG__): recording never allocates
+		const char* Name;
 		long long Start, End;
+		int ProcessID = 0;				// Trace track. 0: host, 1: device
+		const char* Category = "function";
 	};
 
 	struct InstrumentationSession {
@@ -30,40 +56,98 @@ namespace pfr {
 		std::string Name;
 	};
 
-	class Instrumentor {
-		// This class will format the output and dump it to a JSON file
+	class ThreadBuffer {
+		// Preallocated ring of one thread's events. Only the owning thread writes to it.
+		// When full, the oldest events are overwritten and counted as dropped.
+		// Buffers outlive their thread and are handed to the next new thread: one trace track each.
 	private:
-		InstrumentationSession* m_CurrentSession;
-		std::ofstream m_OutputStream;
-		int m_ProfileCount;
+		std::vector<ProfileResult> m_Events;
+		size_t m_Next, m_Count, m_Dropped;
+		uint32_t m_ThreadID;
+		double m_DeviceSeconds;		// Running total of kernel execution recorded by this thread
+		double m_Flops;				// Running total of PROFILE_FLOPS by this thread
 
 	public:
-		// This is a good practice of initializing values in a constructor
-		// You can place empty braces too
-		Instrumentor()
-			: m_CurrentSession(nullptr), m_ProfileCount(0)
+		ThreadBuffer(size_t capacity, uint32_t threadID)
+			: m_Events(capacity), m_Next(0), m_Count(0), m_Dropped(0), m_ThreadID(threadID), m_DeviceSeconds(0), m_Flops(0)
 		{
 
 		}
 
-		void BeginSession(const std::string& name, const std::string& filepath = "results.json") {
-			m_OutputStream.open(filepath);
-			WriteHeader();
-			m_CurrentSession = new InstrumentationSession{ name };
+		void Push(const ProfileResult& result) {
+			m_Events[m_Next] = result;
+			m_Next = m_Next + 1 == m_Events.size() ? 0 : m_Next + 1;
+			if (m_Count < m_Events.size())
+				m_Count++;
+			else
+				m_Dropped++;
 		}
 
-		void EndSession() {
-			WriteFooter();
-			m_OutputStream.close();
-			delete m_CurrentSession;
-			m_CurrentSession = nullptr;
-			m_ProfileCount = 0;
+		// i-th oldest event
+		const ProfileResult& operator[](size_t i) const {
+			return m_Events[(m_Next + m_Events.size() - m_Count + i) % m_Events.size()];
 		}
 
-		void WriteProfile(const ProfileResult& result) {
-			if (m_ProfileCount++ > 0)
-				m_OutputStream << ", ";
+		void Clear() { m_Next = m_Count = m_Dropped = 0; }
+		void Resize(size_t capacity) { m_Events.resize(capacity); Clear(); }
+
+		size_t Count() const { return m_Count; }
+		size_t Dropped() const { return m_Dropped; }
+		uint32_t ThreadID() const { return m_ThreadID; }
+		double& DeviceSeconds() { return m_DeviceSeconds; }
+		double& Flops() { return m_Flops; }
+	};
 
+	class Instrumentor {
+		// Collects events into per-thread buffers and dumps them to a JSON file at EndSession.
+		// Recording takes no lock and does no I/O; a thread only locks on its first event and at exit.
+		// There are only ever as many buffers as threads recording at once: short-lived
+		// threads (host GEMM workers, host tasks) return theirs for reuse when they exit.
+		// EndSession must run once the other threads have stopped recording.
+	private:
+		InstrumentationSession* m_CurrentSession;
+		std::string m_FilePath;
+		size_t m_Capacity;
+		std::mutex m_Lock;			// Guards m_Buffers and m_Free
+		std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+		std::vector<ThreadBuffer*> m_Free;		// Buffers of threads that exited
+		bool m_Echo;
+		bool m_Calibrated;
+		long long m_ClockOffset;	// Host minus device clock, microseconds
+
+		ThreadBuffer* Acquire() {
+			std::lock_guard<std::mutex> lock(m_Lock);
+			if (!m_Free.empty()) {
+				ThreadBuffer* buffer = m_Free.back();
+				m_Free.pop_back();
+				return buffer;
+			}
+			// Sequential track ids, 1 for the first recording thread
+			m_Buffers.push_back(std::make_unique<ThreadBuffer>(m_Capacity, static_cast<uint32_t>(m_Buffers.size() + 1)));
+			return m_Buffers.back().get();
+		}
+
+		void Release(ThreadBuffer* buffer) {
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_Free.push_back(buffer);
+		}
+
+		ThreadBuffer& LocalBuffer() {
+			struct Lease {
+				// Hands the buffer back when its thread exits. Its events stay until EndSession
+				ThreadBuffer* Buffer = nullptr;
+				~Lease() {
+					if (Buffer != nullptr)
+						Instrumentor::Get().Release(Buffer);
+				}
+			};
+			thread_local Lease lease;
+			if (lease.Buffer == nullptr)
+				lease.Buffer = Acquire();
+			return *lease.Buffer;
+		}
+
+		static void WriteEvent(std::ostream& out, const ProfileResult& result, uint32_t threadID) {
 			std::string name = result.Name;
 			std::replace(name.begin(), name.end(), '"', '\'');
 
@@ -79,27 +163,135 @@ namespace pfr {
 				"ts": 5
 			}
 			*/
-			m_OutputStream << "{";
-			m_OutputStream << "\"cat\": \"function\", ";
-			m_OutputStream << "\"dur\": " << (result.End - result.Start) << ",";
-			m_OutputStream << "\"name\": \"" << name << "\",";
-			m_OutputStream << "\"ph\": \"X\",";
-			m_OutputStream << "\"pid\": 0,";
-			m_OutputStream << "\"tid\": 0,";
-			m_OutputStream << "\"ts\": " << result.Start;
-			m_OutputStream << "}";
+			out << "{";
+			out << "\"cat\": \"" << result.Category << "\", ";
+			out << "\"dur\": " << (result.End - result.Start) << ",";
+			out << "\"name\": \"" << name << "\",";
+			out << "\"ph\": \"X\",";
+			out << "\"pid\": " << result.ProcessID << ",";
+			out << "\"tid\": " << threadID << ",";
+			out << "\"ts\": " << result.Start;
+			out << "}";
+		}
+
+	public:
+		// This is a good practice of initializing values in a constructor
+		// You can place empty braces too
+		Instrumentor()
+			: m_CurrentSession(nullptr), m_Capacity(1 << 16), m_Echo(false), m_Calibrated(false), m_ClockOffset(0)
+		{
+
+		}
 
-			m_OutputStream.flush();
+		// eventsPerThread: ring size of each thread's buffer
+		void BeginSession(const std::string& name, const std::string& filepath = "results.json", size_t eventsPerThread = 1 << 16) {
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_FilePath = filepath;
+			m_Capacity = eventsPerThread;
+			for (auto& buffer : m_Buffers)
+				buffer->Resize(m_Capacity);
+			m_CurrentSession = new InstrumentationSession{ name };
+		}
+
+		void EndSession() {
+			std::lock_guard<std::mutex> lock(m_Lock);
+			std::ofstream out(m_FilePath);
+			WriteHeader(out);
+			size_t dropped = 0;
+			for (auto& buffer : m_Buffers) {
+				for (size_t i = 0; i < buffer->Count(); i++) {
+					out << ", ";
+					WriteEvent(out, (*buffer)[i], buffer->ThreadID());
+				}
+				dropped += buffer->Dropped();
+				buffer->Clear();
+			}
+			WriteFooter(out);
+			if (dropped > 0)
+				std::cout << "[PROFILE] " << dropped << " oldest events were overwritten, raise eventsPerThread.\n";
+			delete m_CurrentSession;
+			m_CurrentSession = nullptr;
 		}
 
-		void WriteHeader() {
-			m_OutputStream << "{\"otherData\": {}, \"traceEvents\": [";
-			m_OutputStream.flush();
+		// Opt-in console line per timed scope. Off by default: recording does no I/O.
+		// Set before other threads start recording
+		void EchoScopes(bool on) { m_Echo = on; }
+		bool Echo() const { return m_Echo; }
+
+		void WriteProfile(const ProfileResult& result) {
+			LocalBuffer().Push(result);
 		}
 
-		void WriteFooter() {
-			m_OutputStream << "]}";
-			m_OutputStream.flush();
+		static long long NowMicros() {
+			return std::chrono::time_point_cast<std::chrono::microseconds>(
+				std::chrono::high_resolution_clock::now()).time_since_epoch().count();
+		}
+
+		/*
+		Offset between the host clock and the device clock of a profiling queue, from one
+		empty kernel: its submit..end span is matched to the host time around submit..wait.
+		Call before recording from other threads. One device per session: the last call wins.
+		*/
+		void CalibrateClock(sycl::queue& q) {
+			try {
+				const long long before = NowMicros();
+				sycl::event e = q.single_task([]() {});
+				e.wait();
+				const long long after = NowMicros();
+				const auto submit = e.get_profiling_info<sycl::info::event_profiling::command_submit>();
+				const auto end = e.get_profiling_info<sycl::info::event_profiling::command_end>();
+				m_ClockOffset = (before + after) / 2 - static_cast<long long>((submit + end) / 2000);
+				m_Calibrated = true;
+			}
+			catch (sycl::exception const&) {
+				// Queue without enable_profiling: nothing to calibrate
+			}
+		}
+
+		/*
+		Device track: queue wait (submit -> start) and execution (start -> end) of a
+		completed command, from a queue created with enable_profiling. Device timestamps are
+		moved onto the host clock by the CalibrateClock offset, so events may be recorded any
+		time after they complete. Uncalibrated, the command is assumed to have just finished.
+		Returns the execution time, 0 if the queue does not profile.
+		Kernel events add to DeviceSeconds, transfer (memcpy) events do not.
+		*/
+		double WriteDeviceEvent(const char* name, const sycl::event& e, bool transfer = false) {
+			try {
+				const auto submit = e.get_profiling_info<sycl::info::event_profiling::command_submit>();
+				const auto start = e.get_profiling_info<sycl::info::event_profiling::command_start>();
+				const auto end = e.get_profiling_info<sycl::info::event_profiling::command_end>();
+				const long long offset = m_Calibrated ? m_ClockOffset : NowMicros() - static_cast<long long>(end / 1000);
+
+				ThreadBuffer& buffer = LocalBuffer();
+				buffer.Push({ name, static_cast<long long>(submit / 1000) + offset, static_cast<long long>(start / 1000) + offset, 1, "queued" });
+				buffer.Push({ name, static_cast<long long>(start / 1000) + offset, static_cast<long long>(end / 1000) + offset, 1, transfer ? "transfer" : "device" });
+				const double seconds = (end - start) * 1e-9;
+				if (!transfer)
+					buffer.DeviceSeconds() += seconds;
+				return seconds;
+			}
+			catch (sycl::exception const&) {
+				return 0;
+			}
+		}
+
+		// Kernel execution recorded so far by the calling thread
+		double DeviceSeconds() { return LocalBuffer().DeviceSeconds(); }
+
+		void AddFlops(double flops) { LocalBuffer().Flops() += flops; }
+		double Flops() { return LocalBuffer().Flops(); }
+
+		static void WriteHeader(std::ostream& out) {
+			// Track names for the trace viewer
+			out << "{\"otherData\": {}, \"traceEvents\": [";
+			out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"Host\"}}, ";
+			out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Device\"}}";
+		}
+
+		static void WriteFooter(std::ostream& out) {
+			out << "]}";
+			out.flush();
 		}
 
 		static Instrumentor& Get() {
@@ -111,8 +303,9 @@ namespace pfr {
 	class InstrumentationTimer {
 		// Scope timing class that follows RAII: Resource Acquisition Is Initialization
 	public:
-		InstrumentationTimer(const char* name, std::string mode = "time")
-			: m_Name(name),  m_Mode(mode), m_Stopped(false)
+		InstrumentationTimer(const char* name, Report mode = Report::Time)
+			: m_Name(name),  m_Mode(mode), m_Stopped(false),
+			m_DeviceStart(Instrumentor::Get().DeviceSeconds()), m_FlopsStart(Instrumentor::Get().Flops())
 		{
 			m_StartTimePoint = std::chrono::high_resolution_clock::now();
 		}
@@ -129,18 +322,35 @@ namespace pfr {
 			auto start = std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimePoint).time_since_epoch().count();
 			auto end = std::chrono::time_point_cast<std::chrono::microseconds>(endTimePoint).time_since_epoch().count();
 
-			auto t_Seconds = (end - start) * 1e-6;
-			if (m_Mode == "time")
-				std::cout << m_Name << ": " << t_Seconds << "s\n";
-			else if (m_Mode == "gflops")
-				std::cout << m_Name << ": " << GIGAFLOPS(t_Seconds) << " GFLOPS (" << t_Seconds << "s)\n";
 			Instrumentor::Get().WriteProfile({ m_Name, start, end });
+			m_Stopped = true;
+			if (m_Mode != Report::None && Instrumentor::Get().Echo())
+				Print((end - start) * 1e-6);
 		}
 
 	private:
+		void Print(double t_Seconds) const {
+			// Kernel execution and work recorded inside this scope, if any
+			auto k_Seconds = Instrumentor::Get().DeviceSeconds() - m_DeviceStart;
+			auto flops = Instrumentor::Get().Flops() - m_FlopsStart;
+			const bool gflops = m_Mode == Report::Gflops && flops > 0;
+			if (gflops)
+				std::cout << m_Name << ": " << flops * 1e-9 / t_Seconds << " GFLOPS (" << t_Seconds << "s)";
+			else
+				std::cout << m_Name << ": " << t_Seconds << "s";
+			if (gflops && k_Seconds > 0)
+				std::cout << ", kernel: " << flops * 1e-9 / k_Seconds << " GFLOPS (" << k_Seconds << "s)";
+			else if (k_Seconds > 0)
+				std::cout << ", device: " << k_Seconds << "s";
+			std::cout << "\n";
+		}
+
+
 		const char* m_Name;
-		std::string m_Mode;
+		Report m_Mode;
 		bool m_Stopped;
+		double m_DeviceStart;
+		double m_FlopsStart;
 		std::chrono::time_point<std::chrono::high_resolution_clock> m_StartTimePoint;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+#pragma once
+/*
+Host SGEMM backend. Verification reference for the device kernels and a
+fallback where no SYCL device is available.
+	C[M x P] = alpha * A[M x N] * B[N x P] + beta * C, row-major, leading dimensions as in sgemm.h
+
+Goto/BLIS style blocking:
+	- C is cut into MC x NC blocks, worker threads pull blocks off a shared counter
+	- For each KC slice, the block's A (MC x KC) and B (KC x NC) are packed into
+	  contiguous MR-row / NR-column panels (zero padded at the edges)
+	- An MR x NR micro-kernel keeps the C tile in registers for the whole KC slice
+
+Micro-kernel is picked at runtime from CPUID: AVX-512, AVX2 + FMA, else scalar.
+The SIMD kernels are compiled for their instruction set with target attributes, so the
+project needs no /arch option and the binary still runs on CPUs without them.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NANOBLAS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define NANOBLAS_X86 0
+#endif
+
+/* MSVC emits any intrinsic without /arch, clang and gcc need the target per function */
+#if NANOBLAS_X86 && !(defined(_MSC_VER) && !defined(__clang__))
+#define NANOBLAS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NANOBLAS_TARGET(isa)
+#endif
+
+namespace nanoblas {
+namespace cpu {
+	// Micro-tile of C held in registers: 6 rows x 16 columns.
+	// AVX-512 is one zmm per row, AVX2 two ymm per row (12 accumulators)
+	constexpr size_t MR = 6;
+	constexpr size_t NR = 16;
+
+	// Cache blocking: A block (MC x KC) sits in L2, B panel (KC x NR) in L1
+	constexpr size_t MC = 96;
+	constexpr size_t KC = 256;
+	constexpr size_t NC = 512;
+
+	static_assert(MC % MR == 0 && NC % NR == 0, "Cache blocks must be whole micro-tiles");
+
+	// Rows [0, mc) x cols [0, kc) of A into MR-row panels, k-major inside a panel
+	inline void PackA(size_t mc, size_t kc, const float* A, size_t lda, float* packed) {
+		for (size_t i = 0; i < mc; i += MR) {
+			const size_t rows = std::min(MR, mc - i);
+			for (size_t k = 0; k < kc; k++) {
+				for (size_t r = 0; r < rows; r++)
+					packed[r] = A[(i + r) * lda + k];
+				for (size_t r = rows; r < MR; r++)
+					packed[r] = 0.0f;
+				packed += MR;
+			}
+		}
+	}
+
+	// Rows [0, kc) x cols [0, nc) of B into NR-column panels, k-major inside a panel
+	inline void PackB(size_t kc, size_t nc, const float* B, size_t ldb, float* packed) {
+		for (size_t j = 0; j < nc; j += NR) {
+			const size_t cols = std::min(NR, nc - j);
+			for (size_t k = 0; k < kc; k++) {
+				const float* row = B + k * ldb + j;
+				for (size_t c = 0; c < cols; c++)
+					packed[c] = row[c];
+				for (size_t c = cols; c < NR; c++)
+					packed[c] = 0.0f;
+				packed += NR;
+			}
+		}
+	}
+
+	enum class Isa { Scalar, AVX2, AVX512 };
+
+	inline const char* IsaName(Isa isa) {
+		switch (isa) {
+		case Isa::AVX512: return "AVX-512";
+		case Isa::AVX2: return "AVX2";
+		default: return "scalar";
+		}
+	}
+
+#if NANOBLAS_X86
+	inline void Cpuid(int regs[4], int leaf, int subleaf) {
+#ifdef _MSC_VER
+		__cpuidex(regs, leaf, subleaf);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		regs[0] = static_cast<int>(a); regs[1] = static_cast<int>(b); regs[2] = static_cast<int>(c); regs[3] = static_cast<int>(d);
+#endif
+	}
+
+	// Register state the OS saves on context switches (XCR0)
+	inline uint64_t Xgetbv() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	// Widest micro-kernel this CPU and OS support. Detected once
+	inline Isa HostIsa() {
+		static const Isa isa = []() {
+#if NANOBLAS_X86
+			int regs[4];
+			Cpuid(regs, 0, 0);
+			if (regs[0] < 7)
+				return Isa::Scalar;
+			Cpuid(regs, 1, 0);
+			const bool fma = (regs[2] >> 12) & 1, osxsave = (regs[2] >> 27) & 1;
+			if (!osxsave)
+				return Isa::Scalar;
+			const uint64_t xcr0 = Xgetbv();
+			Cpuid(regs, 7, 0);
+			const bool avx2 = (regs[1] >> 5) & 1, avx512f = (regs[1] >> 16) & 1;
+			if (avx512f && (xcr0 & 0xE6) == 0xE6)		// SSE, AVX, opmask and zmm state
+				return Isa::AVX512;
+			if (avx2 && fma && (xcr0 & 0x6) == 0x6)		// SSE and AVX state
+				return Isa::AVX2;
+#endif
+			return Isa::Scalar;
+		}();
+		return isa;
+	}
+
+	/* acc[MR x NR] = sum over k of a[k] (MR column) * b[k] (NR row) */
+
+	inline void MicroKernelScalar(size_t kc, const float* a, const float* b, float* acc) {
+		/* Fixed trip counts so the compiler can still vectorize the j loop */
+		float c[MR][NR] = {};
+		for (size_t k = 0; k < kc; k++, a += MR, b += NR)
+			for (size_t r = 0; r < MR; r++)
+				for (size_t j = 0; j < NR; j++)
+					c[r][j] += a[r] * b[j];
+		for (size_t r = 0; r < MR; r++)
+			for (size_t j = 0; j < NR; j++)
+				acc[r * NR + j] = c[r][j];
+	}
+
+#if NANOBLAS_X86
+	NANOBLAS_TARGET("avx512f")
+	inline void MicroKernelAVX512(size_t kc, const float* a, const float* b, float* acc) {
+		__m512 c0 = _mm512_setzero_ps(), c1 = _mm512_setzero_ps(), c2 = _mm512_setzero_ps();
+		__m512 c3 = _mm512_setzero_ps(), c4 = _mm512_setzero_ps(), c5 = _mm512_setzero_ps();
+		for (size_t k = 0; k < kc; k++, a += MR, b += NR) {
+			const __m512 vb = _mm512_loadu_ps(b);
+			c0 = _mm512_fmadd_ps(_mm512_set1_ps(a[0]), vb, c0);
+			c1 = _mm512_fmadd_ps(_mm512_set1_ps(a[1]), vb, c1);
+			c2 = _mm512_fmadd_ps(_mm512_set1_ps(a[2]), vb, c2);
+			c3 = _mm512_fmadd_ps(_mm512_set1_ps(a[3]), vb, c3);
+			c4 = _mm512_fmadd_ps(_mm512_set1_ps(a[4]), vb, c4);
+			c5 = _mm512_fmadd_ps(_mm512_set1_ps(a[5]), vb, c5);
+		}
+		_mm512_storeu_ps(acc + 0 * NR, c0);
+		_mm512_storeu_ps(acc + 1 * NR, c1);
+		_mm512_storeu_ps(acc + 2 * NR, c2);
+		_mm512_storeu_ps(acc + 3 * NR, c3);
+		_mm512_storeu_ps(acc + 4 * NR, c4);
+		_mm512_storeu_ps(acc + 5 * NR, c5);
+	}
+
+	NANOBLAS_TARGET("avx2,fma")
+	inline void MicroKernelAVX2(size_t kc, const float* a, const float* b, float* acc) {
+		__m256 c[MR][2];
+		for (size_t r = 0; r < MR; r++)
+			c[r][0] = c[r][1] = _mm256_setzero_ps();
+		for (size_t k = 0; k < kc; k++, a += MR, b += NR) {
+			const __m256 b0 = _mm256_loadu_ps(b);
+			const __m256 b1 = _mm256_loadu_ps(b + 8);
+			for (size_t r = 0; r < MR; r++) {
+				const __m256 va = _mm256_broadcast_ss(a + r);
+				c[r][0] = _mm256_fmadd_ps(va, b0, c[r][0]);
+				c[r][1] = _mm256_fmadd_ps(va, b1, c[r][1]);
+			}
+		}
+		for (size_t r = 0; r < MR; r++) {
+			_mm256_storeu_ps(acc + r * NR, c[r][0]);
+			_mm256_storeu_ps(acc + r * NR + 8, c[r][1]);
+		}
+	}
+#endif
+
+	using MicroKernelFn = void (*)(size_t kc, const float* a, const float* b, float* acc);
+
+	inline MicroKernelFn MicroKernel(Isa isa) {
+#if NANOBLAS_X86
+		if (isa == Isa::AVX512)
+			return &MicroKernelAVX512;
+		if (isa == Isa::AVX2)
+			return &MicroKernelAVX2;
+#endif
+		return &MicroKernelScalar;
+	}
+
+	// C tile (rows x cols of the MR x NR micro-tile) = alpha * acc + beta * C.
+	// Only the first KC slice applies beta, later slices accumulate (beta = 1)
+	inline void StoreTile(size_t rows, size_t cols, float alpha, const float* acc, float beta, float* C, size_t ldc) {
+		for (size_t r = 0; r < rows; r++) {
+			float* c = C + r * ldc;
+			const float* t = acc + r * NR;
+			if (beta == 0.0f)
+				for (size_t j = 0; j < cols; j++) c[j] = alpha * t[j];
+			else if (beta == 1.0f)
+				for (size_t j = 0; j < cols; j++) c[j] += alpha * t[j];
+			else
+				for (size_t j = 0; j < cols; j++) c[j] = alpha * t[j] + beta * c[j];
+		}
+	}
+
+	// One MC x NC block of C, full inner dimension. packA / packB are per-thread scratch
+	inline void GemmBlock(size_t mc, size_t nc, size_t N,
+		float alpha, const float* A, size_t lda, const float* B, size_t ldb,
+		float beta, float* C, size_t ldc,
+		float* packA, float* packB, MicroKernelFn kernel) {
+		alignas(64) float acc[MR * NR];
+		for (size_t pc = 0; pc < N; pc += KC) {
+			const size_t kc = std::min(KC, N - pc);
+			const float beta_k = pc == 0 ? beta : 1.0f;
+			PackB(kc, nc, B + pc * ldb, ldb, packB);
+			PackA(mc, kc, A + pc, lda, packA);
+
+			for (size_t jr = 0; jr < nc; jr += NR) {
+				const size_t cols = std::min(NR, nc - jr);
+				for (size_t ir = 0; ir < mc; ir += MR) {
+					const size_t rows = std::min(MR, mc - ir);
+					kernel(kc, packA + ir * kc, packB + jr * kc, acc);
+					StoreTile(rows, cols, alpha, acc, beta_k, C + ir * ldc + jr, ldc);
+				}
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------
+	// C[M x P] = alpha * A[M x N] * B[N x P] + beta * C on the host.
+	// threads == 0 uses every hardware thread. As in BLAS, C is not read when beta == 0.
+	// The micro-kernel is HostIsa()'s.
+	//-----------------------------------------------------------------------------
+	inline void sgemm(size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda,
+		const float* B, size_t ldb,
+		float beta,
+		float* C, size_t ldc,
+		size_t threads = 0) {
+		if (M == 0 || P == 0)
+			return;
+		if (N == 0 || alpha == 0.0f) {
+			/* Nothing to multiply, only the beta scaling */
+			for (size_t i = 0; i < M; i++)
+				for (size_t j = 0; j < P; j++)
+					C[i * ldc + j] = beta == 0.0f ? 0.0f : beta * C[i * ldc + j];
+			return;
+		}
+
+		const size_t blocksM = (M + MC - 1) / MC;
+		const size_t blocksP = (P + NC - 1) / NC;
+		const size_t blocks = blocksM * blocksP;
+		if (threads == 0)
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		threads = std::min(threads, blocks);
+
+		/* Dynamic schedule: every worker grabs the next C block until none are left,
+		so threads that finish early keep taking work instead of idling */
+		std::atomic<size_t> next{ 0 };
+		const MicroKernelFn kernel = MicroKernel(HostIsa());
+		auto worker = [&]() {
+			std::vector<float> packA(MC * KC);
+			std::vector<float> packB(KC * NC);
+			for (size_t block = next++; block < blocks; block = next++) {
+				const size_t ic = (block / blocksP) * MC;
+				const size_t jc = (block % blocksP) * NC;
+				GemmBlock(std::min(MC, M - ic), std::min(NC, P - jc), N,
+					alpha, A + ic * lda, lda, B + jc, ldb,
+					beta, C + ic * ldc + jc, ldc,
+					packA.data(), packB.data(), kernel);
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (size_t t = 1; t < threads; t++)
+			pool.emplace_back(worker);
+		worker();
+		for (auto& thread : pool)
+			thread.join();
+	}
+}
+}
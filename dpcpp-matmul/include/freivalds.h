@@ -0,0 +1,123 @@
+#pragma once
+/*
+Freivalds' check of C = A * B in O(n^2) (R. Freivalds, "Probabilistic Machines Can Use Less
+Running Time", IFIP 1977): for random vectors r, A * (B * r) must equal C * r.
+A wrong C passes a round with probability ~0 for continuous r, so a few rounds suffice.
+
+Floating point: C was accumulated in T, so row i of C * r differs from A * (B * r) by rounding
+errors relative to the magnitudes involved, (|A| * (|B| * |r|))_i. The worst case bound,
+N * eps(T), is so loose that a single bad element of C hides under it. Rounding errors behave like
+independent random variables instead: each element of C is off by about sqrt(N) * eps(T) of its
+magnitude (Higham and Mary, "A New Approach to Probabilistic Rounding Error Analysis", SISC 2019),
+and P of those summed against r grow as sqrt(P) while the magnitude grows as P.
+The default relative tolerance is FREIVALDS_LAMBDA * sqrt(N / P) * eps(T).
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "common.h"
+#include "philox.h"
+
+namespace nanoblas {
+	constexpr double FREIVALDS_LAMBDA = 8.0;	// Slack over the expected rounding error
+
+	//-----------------------------------------------------------------------------
+	// Y = A * X for K column vectors at once, so A is streamed from memory once.
+	// A is rows x cols (row stride lda), X is cols x K and Y rows x K, both row-major in double.
+	// With Xabs, also Yabs = |A| * Xabs in the same pass. Rows are split across threads,
+	// threads == 0 uses every hardware thread.
+	//-----------------------------------------------------------------------------
+	template <typename T>
+	void Gemv(size_t rows, size_t cols, const T* A, size_t lda, const double* X, size_t K, double* Y,
+		const double* Xabs = nullptr, double* Yabs = nullptr, size_t threads = 0) {
+		if (threads == 0)
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		threads = std::max<size_t>(1, std::min(threads, rows));
+
+		auto worker = [&](size_t t) {
+			std::vector<double> acc(K), accAbs(K);
+			for (size_t i = rows * t / threads; i < rows * (t + 1) / threads; i++) {
+				std::fill(acc.begin(), acc.end(), 0.0);
+				std::fill(accAbs.begin(), accAbs.end(), 0.0);
+				const T* row = A + i * lda;
+				for (size_t j = 0; j < cols; j++) {
+					const double a = static_cast<double>(row[j]);
+					for (size_t v = 0; v < K; v++)
+						acc[v] += a * X[j * K + v];
+					if (Xabs != nullptr)
+						for (size_t v = 0; v < K; v++)
+							accAbs[v] += std::fabs(a) * Xabs[j * K + v];
+				}
+				std::copy(acc.begin(), acc.end(), Y + i * K);
+				if (Yabs != nullptr)
+					std::copy(accAbs.begin(), accAbs.end(), Yabs + i * K);
+			}
+		};
+		std::vector<std::thread> pool;
+		for (size_t t = 1; t < threads; t++)
+			pool.emplace_back(worker, t);
+		worker(0);
+		for (auto& thread : pool)
+			thread.join();
+	}
+
+	//-----------------------------------------------------------------------------
+	// Probabilistic check of C[M, P] == A[M, N] * B[N, P], all row-major and dense.
+	// `rounds` random vectors with entries uniform in [-1, 1) from a Philox stream.
+	// Three passes over memory (B, A, C) in total, whatever the number of rounds.
+	// `tolerance` is relative to |A| * |B| * |r|, 0 picks FREIVALDS_LAMBDA * sqrt(N / P) * eps(T).
+	// Prints the first few failing rows, returns true if every row is within tolerance.
+	//-----------------------------------------------------------------------------
+	template <typename T>
+	bool VerifyFreivalds(size_t M, size_t N, size_t P, const T* A, const T* B, const T* C,
+		size_t rounds = 3, double tolerance = 0, uint64_t seed = 0x5EED) {
+		PROFILE_FUNCTION(Time);
+		std::cout << "Verifying A * B = C with " << rounds << " Freivalds rounds.\n";
+		const size_t K = rounds;
+
+		/* r and |r|: P x K */
+		std::vector<double> r(P * K), rAbs(P * K);
+		const Philox rng(seed);
+		for (size_t i = 0; i < P * K; i++) {
+			r[i] = 2.0 * Philox::Uniform(rng(i / 4).x[i % 4]) - 1.0;
+			rAbs[i] = std::fabs(r[i]);
+		}
+
+		/* Br = B * r, then ABr = A * Br, and the magnitude bound |A| * |B| * |r| alongside */
+		std::vector<double> Br(N * K), BrAbs(N * K), ABr(M * K), ABrAbs(M * K), Cr(M * K);
+		Gemv(N, P, B, P, r.data(), K, Br.data(), rAbs.data(), BrAbs.data());
+		Gemv(M, N, A, N, Br.data(), K, ABr.data(), BrAbs.data(), ABrAbs.data());
+		Gemv(M, P, C, P, r.data(), K, Cr.data());
+
+		/* Integer products are exact. The double reference gets its own worst case bound */
+		const double eps = std::numeric_limits<T>::is_integer ? 0.0 : static_cast<double>(std::numeric_limits<T>::epsilon());
+		const double relative = (tolerance > 0 ? tolerance : FREIVALDS_LAMBDA * std::sqrt(static_cast<double>(N) / P) * eps)
+			+ (N + P) * std::numeric_limits<double>::epsilon();
+
+		size_t errors = 0;
+		double worst = 0;
+		for (size_t i = 0; i < M * K; i++) {
+			const double diff = std::fabs(ABr[i] - Cr[i]);
+			if (ABrAbs[i] > 0)
+				worst = std::max(worst, diff / ABrAbs[i]);
+			if (diff > relative * ABrAbs[i]) {
+				if (errors < 5)
+					std::cout << "Unexpected Result for row [" << i / K << "], vector " << i % K
+						<< " Expected -> " << ABr[i] << " Computed -> " << Cr[i] << "\n";
+				errors++;
+			}
+		}
+
+		std::cout << "Largest relative error: " << worst << " (tolerance " << relative << ")\n";
+		if (errors == 0) {
+			std::cout << ":) Results Match.\n";
+			return true;
+		}
+		std::cout << ":( Failed. " << errors << " of " << M * K << " row checks out of tolerance.\n";
+		return false;
+	}
+}
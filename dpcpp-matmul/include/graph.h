@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+#include "matrix.h"
+#include "sgemm.h"
+
+namespace nanoblas {
+	class Graph {
+		// Records nanoblas operations on Matrix objects instead of running them.
+		// Compile() works out the schedule once:
+		//	1. Fusion: GEMM into T, directly followed by D = alpha * T + beta * D, with T dead
+		//	   afterwards, becomes one GEMM into D
+		//	2. Dead ops: ops whose result is overwritten or never reaches an Output() are dropped
+		//	3. Dependencies: read-after-write, write-after-read and write-after-write on each Matrix
+		// Run() submits every op with only its own dependencies as events and waits on nothing,
+		// so the whole graph is one submission burst. Replaying reuses the compiled schedule.
+		// Recorded matrices must outlive the graph.
+	private:
+		enum class OpKind { Gemm, Geam };
+
+		struct Op {
+			OpKind Kind;
+			Transpose TransA, TransB;
+			float Alpha, Beta;
+			const Matrix* A;
+			const Matrix* B;
+			Matrix* C;
+
+			// Every op writes the whole of C
+			std::vector<const Matrix*> Reads() const {
+				std::vector<const Matrix*> reads{ A };
+				if (Kind == OpKind::Gemm) {
+					reads.push_back(B);
+					if (Beta != 0.0f)
+						reads.push_back(C);
+				}
+				else if (Beta != 0.0f)
+					reads.push_back(B);
+				return reads;
+			}
+		};
+
+		struct Step {
+			std::function<sycl::event(const std::vector<sycl::event>&)> Launch;
+			std::vector<size_t> Deps;		// Indices of earlier steps
+			bool Sink = true;				// No later step depends on it
+		};
+
+		Context* m_Context;
+		std::vector<Op> m_Ops;
+		std::set<const Matrix*> m_Outputs;
+		std::vector<Step> m_Plan;
+		bool m_Compiled = false;
+		size_t m_Fused = 0, m_Dropped = 0;
+
+		static size_t Rows(const Matrix& m, Transpose t) { return t == Transpose::Trans ? m.Cols() : m.Rows(); }
+		static size_t Cols(const Matrix& m, Transpose t) { return t == Transpose::Trans ? m.Rows() : m.Cols(); }
+
+		static bool Reads(const Op& op, const Matrix* m) {
+			auto reads = op.Reads();
+			return std::find(reads.begin(), reads.end(), m) != reads.end();
+		}
+
+		void Record(const Op& op) {
+			m_Ops.push_back(op);
+			m_Compiled = false;
+		}
+
+		// T stays unread from op `from` on until it is overwritten or the graph ends
+		bool DeadFrom(const Matrix* t, size_t from) const {
+			if (m_Outputs.count(t))
+				return false;
+			for (size_t i = from; i < m_Ops.size(); i++) {
+				if (Reads(m_Ops[i], t))
+					return false;
+				if (m_Ops[i].C == t)
+					return true;
+			}
+			return true;
+		}
+
+		std::vector<Op> Fuse() {
+			std::vector<Op> ops;
+			for (size_t i = 0; i < m_Ops.size(); i++) {
+				const Op& gemm = m_Ops[i];
+				if (i + 1 < m_Ops.size() && gemm.Kind == OpKind::Gemm && gemm.Beta == 0.0f) {
+					const Op& geam = m_Ops[i + 1];
+					const Matrix* t = gemm.C;
+					Matrix* d = geam.C;
+					if (geam.Kind == OpKind::Geam && geam.A == t && geam.TransA == Transpose::None
+						&& (geam.Beta == 0.0f || (geam.B == d && geam.TransB == Transpose::None))
+						&& d != t && d != gemm.A && d != gemm.B
+						&& DeadFrom(t, i + 2)) {
+						Op fused = gemm;
+						fused.Alpha = geam.Alpha * gemm.Alpha;
+						fused.Beta = geam.Beta;
+						fused.C = d;
+						ops.push_back(fused);
+						m_Fused++;
+						i++;
+						continue;
+					}
+				}
+				ops.push_back(gemm);
+			}
+			return ops;
+		}
+
+		// Backward liveness: an op is live if a later live op or an output needs what it writes
+		std::vector<bool> Liveness(const std::vector<Op>& ops) const {
+			std::vector<bool> live(ops.size(), false);
+			std::set<const Matrix*> needed = m_Outputs;
+			if (needed.empty())
+				for (const Op& op : ops)
+					needed.insert(op.C);
+			for (size_t i = ops.size(); i-- > 0;) {
+				if (!needed.count(ops[i].C))
+					continue;
+				live[i] = true;
+				needed.erase(ops[i].C);
+				for (const Matrix* m : ops[i].Reads())
+					needed.insert(m);
+			}
+			return live;
+		}
+
+		std::function<sycl::event(const std::vector<sycl::event>&)> Launcher(const Op& op) {
+			Context* ctx = m_Context;
+			const bool tA = op.TransA == Transpose::Trans;
+			const bool tB = op.TransB == Transpose::Trans;
+			const float alpha = op.Alpha, beta = op.Beta;
+			const float* A = op.A->Data();
+			const float* B = op.B->Data();
+			float* C = op.C->Data();
+			const size_t lda = op.A->Cols(), ldb = op.B->Cols(), ldc = op.C->Cols();
+			const size_t M = op.C->Rows(), P = op.C->Cols();
+			if (op.Kind == OpKind::Gemm) {
+				/* Shapes were checked at record time: go straight to the kernel dispatch */
+				const size_t N = Cols(*op.A, op.TransA);
+				return [=](const std::vector<sycl::event>& deps) {
+					return SgemmDispatch(*ctx, tA, tB, M, P, N, alpha, StridedBatch{ A, 0, B, 0, C, 0 }, lda, ldb, beta, ldc, 1, deps);
+				};
+			}
+			const Transpose transA = op.TransA, transB = op.TransB;
+			return [=](const std::vector<sycl::event>& deps) {
+				return sgeam_async(*ctx, transA, transB, M, P, alpha, A, lda, beta, B, ldb, C, ldc, deps);
+			};
+		}
+
+	public:
+		explicit Graph(Context& ctx)
+			: m_Context(&ctx)
+		{
+
+		}
+
+		// C = alpha * op(A) * op(B) + beta * C
+		void Gemm(Transpose transA, Transpose transB, float alpha, const Matrix& a, const Matrix& b, float beta, Matrix& c) {
+			if (Cols(a, transA) != Rows(b, transB) || c.Rows() != Rows(a, transA) || c.Cols() != Cols(b, transB)) {
+				std::cout << "[ERROR] Graph::Gemm: operand shapes do not match.\n";
+				return;
+			}
+			if (&c == &a || &c == &b) {
+				std::cout << "[ERROR] Graph::Gemm: C can not be an input.\n";
+				return;
+			}
+			Record({ OpKind::Gemm, transA, transB, alpha, beta, &a, &b, &c });
+		}
+
+		// C = alpha * op(A) + beta * op(B)
+		void Geam(Transpose transA, Transpose transB, float alpha, const Matrix& a, float beta, const Matrix& b, Matrix& c) {
+			if (c.Rows() != Rows(a, transA) || c.Cols() != Cols(a, transA)
+				|| (beta != 0.0f && (c.Rows() != Rows(b, transB) || c.Cols() != Cols(b, transB)))) {
+				std::cout << "[ERROR] Graph::Geam: operand shapes do not match.\n";
+				return;
+			}
+			if ((&c == &a && transA == Transpose::Trans) || (beta != 0.0f && &c == &b && transB == Transpose::Trans)) {
+				std::cout << "[ERROR] Graph::Geam: in-place transpose is not supported.\n";
+				return;
+			}
+			Record({ OpKind::Geam, transA, transB, alpha, beta, &a, &b, &c });
+		}
+
+		// C = A^T
+		void TransposeTo(const Matrix& a, Matrix& c) {
+			Geam(Transpose::Trans, Transpose::None, 1.0f, a, 0.0f, a, c);
+		}
+
+		// Matrices whose final value is needed after Run(). Without any, the final value of
+		// every written matrix is kept, but a write overwritten before anything reads it is still dropped
+		void Output(const Matrix& m) {
+			m_Outputs.insert(&m);
+			m_Compiled = false;
+		}
+
+		void Compile() {
+			m_Plan.clear();
+			m_Fused = m_Dropped = 0;
+			const std::vector<Op> ops = Fuse();
+			const std::vector<bool> live = Liveness(ops);
+
+			std::map<const Matrix*, size_t> lastWriter;
+			std::map<const Matrix*, std::vector<size_t>> readers;
+			for (size_t i = 0; i < ops.size(); i++) {
+				if (!live[i]) {
+					m_Dropped++;
+					continue;
+				}
+				const Op& op = ops[i];
+				const size_t id = m_Plan.size();
+				std::set<size_t> deps;
+				for (const Matrix* m : op.Reads()) {
+					auto w = lastWriter.find(m);
+					if (w != lastWriter.end())
+						deps.insert(w->second);		/* RAW */
+				}
+				auto w = lastWriter.find(op.C);
+				if (w != lastWriter.end())
+					deps.insert(w->second);			/* WAW */
+				for (size_t r : readers[op.C])
+					deps.insert(r);					/* WAR */
+
+				for (const Matrix* m : op.Reads())
+					readers[m].push_back(id);
+				lastWriter[op.C] = id;
+				readers[op.C].clear();
+
+				Step step;
+				step.Launch = Launcher(op);
+				step.Deps.assign(deps.begin(), deps.end());
+				for (size_t d : step.Deps)
+					m_Plan[d].Sink = false;
+				m_Plan.push_back(step);
+			}
+			m_Compiled = true;
+		}
+
+		// Submit the graph after deps. The returned event completes with the whole graph
+		sycl::event Run(const std::vector<sycl::event>& deps = {}) {
+			if (!m_Compiled)
+				Compile();
+			std::vector<sycl::event> events;
+			std::vector<sycl::event> sinks;
+			events.reserve(m_Plan.size());
+			for (const Step& step : m_Plan) {
+				/* Only the roots wait on deps, the rest inherit them */
+				std::vector<sycl::event> stepDeps = step.Deps.empty() ? deps : std::vector<sycl::event>{};
+				for (size_t d : step.Deps)
+					stepDeps.push_back(events[d]);
+				events.push_back(step.Launch(stepDeps));
+				if (step.Sink)
+					sinks.push_back(events.back());
+			}
+			return sinks.size() == 1 ? sinks.front() : Join(*m_Context, sinks.empty() ? deps : sinks);
+		}
+
+		void Print() {
+			if (!m_Compiled)
+				Compile();
+			std::cout << "[GRAPH] " << m_Ops.size() << " recorded, " << m_Fused << " fused, "
+				<< m_Dropped << " dropped, " << m_Plan.size() << " submitted\n";
+		}
+	};
+}
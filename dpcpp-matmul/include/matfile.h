@@ -0,0 +1,249 @@
+#pragma once
+/*
+Binary matrix file (.nbm), little-endian:
+	[0, 64)				MatFileHeader
+	[DataOffset, ...)	Rows * Cols elements, DataOffset is a multiple of Alignment
+
+Files are memory-mapped, not read: Data() points into the mapped pages, which go
+straight into Matrix::CopyFromHost or sgemm_streaming without a staging copy.
+The mapping is copy-on-write, so writing through Data() never touches the file.
+*/
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nanoblas {
+	enum class DType : uint32_t { Float32 = 0 };
+	enum class Layout : uint32_t { RowMajor = 0, ColMajor = 1 };
+
+	struct MatFileHeader {
+		char Magic[4];			// "NBMX"
+		uint32_t Version;
+		DType Type;
+		Layout Order;
+		uint64_t Rows;
+		uint64_t Cols;
+		uint64_t Alignment;		// Of the data section, in bytes
+		uint64_t DataOffset;
+		uint8_t Reserved[16];
+	};
+	static_assert(sizeof(MatFileHeader) == 64, "Header is 64 bytes on disk");
+
+	constexpr char MATFILE_MAGIC[4] = { 'N', 'B', 'M', 'X' };
+	constexpr uint32_t MATFILE_VERSION = 1;
+
+	// Page alignment by default, so mapped data is aligned for any vector load
+	inline bool WriteMatrixFile(const std::string& path, size_t rows, size_t cols, const float* data,
+		Layout order = Layout::RowMajor, size_t alignment = 4096) {
+		PROFILE_FUNCTION(Time);
+		if (alignment < sizeof(MatFileHeader) || (alignment & (alignment - 1)) != 0) {
+			std::cout << "[ERROR] Matrix file alignment must be a power of two of at least 64 bytes.\n";
+			return false;
+		}
+		MatFileHeader header{};
+		std::memcpy(header.Magic, MATFILE_MAGIC, sizeof(header.Magic));
+		header.Version = MATFILE_VERSION;
+		header.Type = DType::Float32;
+		header.Order = order;
+		header.Rows = rows;
+		header.Cols = cols;
+		header.Alignment = alignment;
+		header.DataOffset = alignment;
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			std::cout << "[ERROR] Can not open " << path << " for writing.\n";
+			return false;
+		}
+		std::vector<char> padding(header.DataOffset - sizeof(header), 0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(padding.data(), padding.size());
+		out.write(reinterpret_cast<const char*>(data), rows * cols * sizeof(float));
+		if (!out) {
+			std::cout << "[ERROR] Failed writing " << path << ".\n";
+			return false;
+		}
+		return true;
+	}
+
+	class MappedMatrix {
+		// View of a .nbm file through a memory mapping.
+		// Invalid (operator bool is false) if default constructed, or the file is missing or malformed.
+	private:
+		MatFileHeader m_Header{};
+		void* m_Map = nullptr;
+		size_t m_MapBytes = 0;
+#ifdef _WIN32
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_Mapping = nullptr;
+#endif
+
+		bool Map(const std::string& path) {
+#ifdef _WIN32
+			m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_File == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+				return false;
+			m_MapBytes = static_cast<size_t>(size.QuadPart);
+			m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (m_Mapping == nullptr)
+				return false;
+			m_Map = MapViewOfFile(m_Mapping, FILE_MAP_COPY, 0, 0, 0);
+			return m_Map != nullptr;
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size == 0) {
+				close(fd);
+				return false;
+			}
+			m_MapBytes = static_cast<size_t>(st.st_size);
+			void* map = mmap(nullptr, m_MapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			close(fd);	// The mapping keeps the file alive
+			if (map == MAP_FAILED)
+				return false;
+			madvise(map, m_MapBytes, MADV_SEQUENTIAL);
+			m_Map = map;
+			return true;
+#endif
+		}
+
+		void Unmap() {
+#ifdef _WIN32
+			if (m_Map != nullptr)
+				UnmapViewOfFile(m_Map);
+			if (m_Mapping != nullptr)
+				CloseHandle(m_Mapping);
+			if (m_File != INVALID_HANDLE_VALUE)
+				CloseHandle(m_File);
+			m_Mapping = nullptr;
+			m_File = INVALID_HANDLE_VALUE;
+#else
+			if (m_Map != nullptr)
+				munmap(m_Map, m_MapBytes);
+#endif
+			m_Map = nullptr;
+			m_MapBytes = 0;
+		}
+
+		bool CheckHeader(const std::string& path) {
+			if (m_MapBytes < sizeof(MatFileHeader)) {
+				std::cout << "[ERROR] " << path << " is too small for a matrix header.\n";
+				return false;
+			}
+			std::memcpy(&m_Header, m_Map, sizeof(m_Header));
+			if (std::memcmp(m_Header.Magic, MATFILE_MAGIC, sizeof(m_Header.Magic)) != 0 || m_Header.Version != MATFILE_VERSION) {
+				std::cout << "[ERROR] " << path << " is not a version " << MATFILE_VERSION << " matrix file.\n";
+				return false;
+			}
+			if (m_Header.Type != DType::Float32) {
+				std::cout << "[ERROR] " << path << ": only float32 matrices are supported.\n";
+				return false;
+			}
+			if (m_Header.Order != Layout::RowMajor && m_Header.Order != Layout::ColMajor) {
+				std::cout << "[ERROR] " << path << ": unknown layout " << static_cast<uint32_t>(m_Header.Order) << ".\n";
+				return false;
+			}
+			/* Untrusted sizes: no products or sums that can wrap around */
+			const uint64_t alignment = m_Header.Alignment;
+			if (alignment < sizeof(MatFileHeader) || (alignment & (alignment - 1)) != 0 || m_Header.DataOffset % alignment != 0) {
+				std::cout << "[ERROR] " << path << " has a misaligned data section.\n";
+				return false;
+			}
+			if (m_Header.Rows > SIZE_MAX || (m_Header.Cols != 0 && m_Header.Rows > (SIZE_MAX / sizeof(float)) / m_Header.Cols)) {
+				std::cout << "[ERROR] " << path << " is too large: " << m_Header.Rows << "x" << m_Header.Cols << ".\n";
+				return false;
+			}
+			const uint64_t bytes = m_Header.Rows * m_Header.Cols * sizeof(float);
+			if (m_Header.DataOffset < sizeof(MatFileHeader) || m_Header.DataOffset > m_MapBytes || bytes > m_MapBytes - m_Header.DataOffset) {
+				std::cout << "[ERROR] " << path << " is truncated.\n";
+				return false;
+			}
+			return true;
+		}
+
+	public:
+		MappedMatrix() = default;
+
+		explicit MappedMatrix(const std::string& path) {
+			PROFILE_FUNCTION(Time);
+			if (!Map(path)) {
+				std::cout << "[ERROR] Can not map " << path << ".\n";
+				Unmap();
+				return;
+			}
+			if (!CheckHeader(path))
+				Unmap();
+		}
+
+		~MappedMatrix() {
+			Unmap();
+		}
+
+		// Mappings are not shared: move only
+		MappedMatrix(const MappedMatrix&) = delete;
+		MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+		MappedMatrix(MappedMatrix&& other) noexcept
+			: m_Header(other.m_Header),
+			m_Map(std::exchange(other.m_Map, nullptr)),
+			m_MapBytes(std::exchange(other.m_MapBytes, 0))
+#ifdef _WIN32
+			, m_File(std::exchange(other.m_File, INVALID_HANDLE_VALUE)),
+			m_Mapping(std::exchange(other.m_Mapping, nullptr))
+#endif
+		{
+
+		}
+
+		MappedMatrix& operator=(MappedMatrix&& other) noexcept {
+			if (this != &other) {
+				Unmap();
+				m_Header = other.m_Header;
+				m_Map = std::exchange(other.m_Map, nullptr);
+				m_MapBytes = std::exchange(other.m_MapBytes, 0);
+#ifdef _WIN32
+				m_File = std::exchange(other.m_File, INVALID_HANDLE_VALUE);
+				m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#endif
+			}
+			return *this;
+		}
+
+		explicit operator bool() const { return m_Map != nullptr; }
+
+		size_t Rows() const { return m_Header.Rows; }
+		size_t Cols() const { return m_Header.Cols; }
+		Layout Order() const { return m_Header.Order; }
+		size_t Bytes() const { return Rows() * Cols() * sizeof(float); }
+
+		// Points into the mapping, valid while this object lives
+		float* Data() { return m_Map ? reinterpret_cast<float*>(static_cast<char*>(m_Map) + m_Header.DataOffset) : nullptr; }
+		const float* Data() const { return m_Map ? reinterpret_cast<const float*>(static_cast<const char*>(m_Map) + m_Header.DataOffset) : nullptr; }
+	};
+}
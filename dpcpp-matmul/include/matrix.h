@@ -0,0 +1,131 @@
+#pragma once
+#include <CL/sycl.hpp>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+namespace nanoblas {
+	class Context {
+		// Owns the queue that every device-resident Matrix is allocated against.
+		// Operands allocated here stay on the device until the Matrix dies.
+	private:
+		sycl::queue m_Queue;
+
+	public:
+		explicit Context(const sycl::queue& q)
+			: m_Queue(q)
+		{
+
+		}
+
+		sycl::queue& Queue() { return m_Queue; }
+		sycl::device Device() const { return m_Queue.get_device(); }
+
+		float* Allocate(size_t count) {
+			float* ptr = sycl::malloc_device<float>(count, m_Queue);
+			if (ptr == nullptr) {
+				std::cout << "Failed to allocate " << count * sizeof(float) / 1024 / 1024 << " MB on device.\n";
+				std::terminate();
+			}
+			return ptr;
+		}
+
+		// Pinned host memory: copies from and to it run at full speed and overlap kernels
+		float* AllocateHost(size_t count) {
+			float* ptr = sycl::malloc_host<float>(count, m_Queue);
+			if (ptr == nullptr) {
+				std::cout << "Failed to allocate " << count * sizeof(float) / 1024 / 1024 << " MB of pinned host memory.\n";
+				std::terminate();
+			}
+			return ptr;
+		}
+
+		// Any USM allocation of this context
+		void Free(float* ptr) {
+			if (ptr != nullptr)
+				sycl::free(ptr, m_Queue);
+		}
+	};
+
+	class Matrix {
+		// Row-major [Rows x Cols] float matrix in USM device memory.
+		// Nothing is copied implicitly: use CopyFromHost/CopyToHost when data has to move.
+		// The *Async forms run after deps and return the copy's event instead of waiting.
+	private:
+		Context* m_Context;
+		size_t m_Rows, m_Cols;
+		float* m_Data;
+
+	public:
+		Matrix(Context& ctx, size_t rows, size_t cols)
+			: m_Context(&ctx), m_Rows(rows), m_Cols(cols), m_Data(ctx.Allocate(rows * cols))
+		{
+
+		}
+
+		Matrix(Context& ctx, size_t rows, size_t cols, const float* host)
+			: Matrix(ctx, rows, cols)
+		{
+			CopyFromHost(host);
+		}
+
+		~Matrix() {
+			if (m_Context != nullptr)
+				m_Context->Free(m_Data);
+		}
+
+		// Device allocations are not shared: move only
+		Matrix(const Matrix&) = delete;
+		Matrix& operator=(const Matrix&) = delete;
+
+		Matrix(Matrix&& other) noexcept
+			: m_Context(other.m_Context), m_Rows(other.m_Rows), m_Cols(other.m_Cols), m_Data(other.m_Data)
+		{
+			other.m_Context = nullptr;
+			other.m_Data = nullptr;
+		}
+
+		Matrix& operator=(Matrix&& other) noexcept {
+			if (this != &other) {
+				if (m_Context != nullptr)
+					m_Context->Free(m_Data);
+				m_Context = std::exchange(other.m_Context, nullptr);
+				m_Data = std::exchange(other.m_Data, nullptr);
+				m_Rows = other.m_Rows;
+				m_Cols = other.m_Cols;
+			}
+			return *this;
+		}
+
+		void CopyFromHost(const float* host) {
+			sycl::event e = CopyFromHostAsync(host);
+			e.wait();
+			PROFILE_TRANSFER(e);
+		}
+
+		void CopyToHost(float* host) const {
+			sycl::event e = CopyToHostAsync(host);
+			e.wait();
+			PROFILE_TRANSFER(e);
+		}
+
+		// host must stay valid until the returned event completes
+		sycl::event CopyFromHostAsync(const float* host, const std::vector<sycl::event>& deps = {}) {
+			return m_Context->Queue().memcpy(m_Data, host, Bytes(), deps);
+		}
+
+		sycl::event CopyToHostAsync(float* host, const std::vector<sycl::event>& deps = {}) const {
+			return m_Context->Queue().memcpy(host, m_Data, Bytes(), deps);
+		}
+
+		size_t Rows() const { return m_Rows; }
+		size_t Cols() const { return m_Cols; }
+		size_t Size() const { return m_Rows * m_Cols; }
+		size_t Bytes() const { return Size() * sizeof(float); }
+
+		Context& GetContext() const { return *m_Context; }
+		float* Data() { return m_Data; }
+		const float* Data() const { return m_Data; }
+	};
+}
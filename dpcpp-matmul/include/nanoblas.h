@@ -2,14 +2,18 @@
 #include <CL/sycl.hpp>
 #include "common.h"
 #include "dpc_common.hpp"
+#include "cpu_gemm.h"
+#include "matrix.h"
 #include <vector>
 #include "settings.h"
 
 sycl::queue create_device_queue() {
-	PROFILE_FUNCTION("time");
+	PROFILE_FUNCTION(Time);
 	try {
 		sycl::default_selector d_selector;
-		sycl::queue q(d_selector, dpc_common::exception_handler);
+		/* Profiling queue: kernel and copy events carry device timestamps for the trace */
+		sycl::queue q(d_selector, dpc_common::exception_handler, sycl::property::queue::enable_profiling{});
+		PROFILE_CALIBRATE(q);
 		std::cout << "Enumerated Device: " << q.get_device().get_info<sycl::info::device::name>() << "\n";
 		auto wgroup_size = q.get_device().get_info<sycl::info::device::max_work_group_size>();
 		auto local_mem_size = q.get_device().get_info<sycl::info::device::local_mem_size>();
@@ -32,39 +36,108 @@ sycl::queue create_device_queue() {
 }
 
 
+//-----------------------------------------------------------------------------
+// Ragged edges: nd_ranges are rounded up to whole work-groups, out-of-range
+// loads read 0 and out-of-range stores are skipped. No host-side padding.
+//-----------------------------------------------------------------------------
+inline size_t RoundUp(size_t x, size_t multiple) {
+	return (x + multiple - 1) / multiple * multiple;
+}
+
+inline size_t CeilDiv(size_t x, size_t y) {
+	return (x + y - 1) / y;
+}
+
+// Element (row, col) of a [rows x cols] row-major matrix with row stride ld, 0 outside
+inline float LoadOrZero(const float* mat, size_t ld, size_t row, size_t col, size_t rows, size_t cols) {
+	return (row < rows && col < cols) ? mat[row * ld + col] : 0.0f;
+}
+
+// WIDTH consecutive elements starting at (row, col). One vector load when the
+// rows are WIDTH-aligned and the vector is in range, else lane by lane
+template <int WIDTH>
+inline sycl::vec<float, WIDTH> LoadWide(const float* mat, size_t ld, size_t row, size_t col, size_t rows, size_t cols, bool aligned) {
+	if (aligned && row < rows && col + WIDTH <= cols)
+		return *reinterpret_cast<const sycl::vec<float, WIDTH>*>(mat + row * ld + col);
+	sycl::vec<float, WIDTH> v(0.0f);
+	for (int w = 0; w < WIDTH; w++)
+		v[w] = LoadOrZero(mat, ld, row, col + w, rows, cols);
+	return v;
+}
+
+template <int WIDTH>
+inline void StoreWide(float* mat, size_t ld, size_t row, size_t col, size_t rows, size_t cols, bool aligned, const sycl::vec<float, WIDTH>& v) {
+	if (row >= rows)
+		return;
+	if (aligned && col + WIDTH <= cols) {
+		*reinterpret_cast<sycl::vec<float, WIDTH>*>(mat + row * ld + col) = v;
+		return;
+	}
+	for (int w = 0; w < WIDTH; w++)
+		if (col + w < cols)
+			mat[row * ld + col + w] = v[w];
+}
+
+//-----------------------------------------------------------------------------
+// Batches: where the operands of batch entry b live. A single GEMM is a
+// StridedBatch of size 1. Pointer arrays must be USM-accessible on the device.
+//-----------------------------------------------------------------------------
+struct StridedBatch {
+	const float* A; size_t StrideA;
+	const float* B; size_t StrideB;
+	float* C; size_t StrideC;
+
+	const float* GetA(size_t b) const { return A + b * StrideA; }
+	const float* GetB(size_t b) const { return B + b * StrideB; }
+	float* GetC(size_t b) const { return C + b * StrideC; }
+};
+
+struct PointerArrayBatch {
+	const float* const* A;
+	const float* const* B;
+	float* const* C;
+
+	const float* GetA(size_t b) const { return A[b]; }
+	const float* GetB(size_t b) const { return B[b]; }
+	float* GetC(size_t b) const { return C[b]; }
+};
+
 //-----------------------------------------------------------------------------
 // Kernel-1: Naive approach (roofline model) 
+// BLAS-general like Kernel-5, so it also serves every shape the tiled kernels can't.
+// Sgemm* launchers do not wait: they run after deps and return the kernel's event.
 //-----------------------------------------------------------------------------
-void MatrixMulParallelNaive(sycl::queue& q, 
-	size_t M, size_t N, size_t P,
-	float* a_host,
-	float* b_host,
-	float* c_gpu) {
-	
-	PROFILE_FUNCTION("gflops");
+template <typename Batch>
+sycl::event SgemmNaiveBatched(sycl::queue& q, bool transA, bool transB,
+	size_t M, size_t P, size_t N,
+	float alpha,
+	const Batch& batch, size_t lda, size_t ldb,
+	float beta, size_t ldc,
+	size_t batch_count,
+	const std::vector<sycl::event>& deps = {}) {
 	try {
-		
-		sycl::buffer<float, 1> a(a_host, sycl::range<1>{M*N});
-		sycl::buffer<float, 1> b(b_host, sycl::range<1>{N*P});
-		sycl::buffer<float, 1> c(c_gpu, sycl::range<1>{M*P});
-		
-		auto e = q.submit([&](sycl::handler& h) {
-
-			auto A = a.template get_access<sycl::access::mode::read>(h);
-			auto B = b.template get_access<sycl::access::mode::read>(h);
-			auto C = c.template get_access<sycl::access::mode::write>(h);
-			
-			h.parallel_for(sycl::range<1>{M*P}, [=](sycl::id<1> index) {
-				size_t row = index / M;
-				size_t col = index % M;
-				auto sum = 0;
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			h.parallel_for(sycl::range<2>{batch_count, M*P}, [=](sycl::id<2> id) {
+				/* Operands of this batch entry */
+				const float* A = batch.GetA(id[0]);
+				const float* B = batch.GetB(id[0]);
+				float* C = batch.GetC(id[0]);
+
+				size_t index = id[1];
+				size_t row = index / P;
+				size_t col = index % P;
+				float sum = 0;
 				// Compute result of ONE element of C
-				for (size_t i = 0; i < N; i++)
-					sum += A[row * M + i] * B[i * N + col];
-				C[index] = sum;
+				for (size_t i = 0; i < N; i++) {
+					float valA = transA ? A[i * lda + row] : A[row * lda + i];
+					float valB = transB ? B[col * ldb + i] : B[i * ldb + col];
+					sum += valA * valB;
+				}
+				float& out = C[row * ldc + col];
+				out = beta == 0.0f ? alpha * sum : alpha * sum + beta * out;
 				});
 			});
-		e.wait();
 	}
 	catch (sycl::exception const& e) {
 		std::cout << "An exception is caught while multiplying matrices.\n";
@@ -72,33 +145,54 @@ void MatrixMulParallelNaive(sycl::queue& q,
 	}
 }
 
+sycl::event SgemmNaive(sycl::queue& q, bool transA, bool transB,
+	size_t M, size_t P, size_t N,
+	float alpha,
+	const float* A, size_t lda,
+	const float* B, size_t ldb,
+	float beta,
+	float* C, size_t ldc,
+	const std::vector<sycl::event>& deps = {}) {
+	return SgemmNaiveBatched(q, transA, transB, M, P, N, alpha, StridedBatch{ A, 0, B, 0, C, 0 }, lda, ldb, beta, ldc, 1, deps);
+}
+
+void MatrixMulParallelNaive(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	
+	PROFILE_FUNCTION(Gflops);
+	const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+	sycl::event e = SgemmNaive(ctx.Queue(), false, false, M, P, N, 1.0f, a.Data(), N, b.Data(), P, 0.0f, c.Data(), P);
+	e.wait();
+	PROFILE_EVENT(e);
+	PROFILE_FLOPS(2.0 * M * N * P);
+}
+
 //-----------------------------------------------------------------------------
 // Kernel-2: Tiled approach -> use on-chip cache 
 //-----------------------------------------------------------------------------
-void MatrixMulTiled(sycl::queue& q,
-	size_t M, size_t N, size_t P,
-	float* a_host,
-	float* b_host,
-	float* c_gpu) {
-	PROFILE_FUNCTION("gflops");
+template <size_t TS>
+void MatrixMulTiled(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	PROFILE_FUNCTION(Gflops);
 	try {
-		/* Create buffers */
-		sycl::buffer<float, 1> a(a_host, sycl::range<1>{M* N});
-		sycl::buffer<float, 1> b(b_host, sycl::range<1>{N* P});
-		sycl::buffer<float, 1> c(c_gpu, sycl::range<1>{M* P});
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
 
-		auto e = q.submit([&](sycl::handler& h) {
-			/* Create accessors */
-			auto A = a.template get_access<sycl::access::mode::read>(h);
-			auto B = b.template get_access<sycl::access::mode::read>(h);
-			auto C = c.template get_access<sycl::access::mode::write>(h);
+		/* Device-resident operands */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
 
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
 			/* Local accessor TILES: hyperfast cache */
 			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Asub(sycl::range<2>{TS, TS}, h);
 			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Bsub(sycl::range<2>{TS, TS}, h);
 
 			/* Create kernel */
-			h.parallel_for(sycl::nd_range<2>(sycl::range<2>(M, P), sycl::range<2>(TS, TS)), [=](sycl::nd_item<2> item) {
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>(RoundUp(M, TS), RoundUp(P, TS)), sycl::range<2>(TS, TS)), [=](sycl::nd_item<2> item) {
 				/* row, col thread identifier for each tile */
 				size_t row = item.get_local_id(0);
 				size_t col = item.get_local_id(1);
@@ -109,13 +203,13 @@ void MatrixMulTiled(sycl::queue& q,
 
 				float acc = 0;
 				/* loop over all tiles */
-				const size_t num_tiles = N / TS;
+				const size_t num_tiles = CeilDiv(N, TS);
 				for (size_t t = 0; t < num_tiles; t++) {
 					/* Load one tile of A and B into cache */
 					const size_t tiledRow = TS * t + row;
 					const size_t tiledCol = TS * t + col;
-					Asub[row][col] = A[globalRow * N + tiledCol];
-					Bsub[row][col] = B[tiledRow * P + globalCol];
+					Asub[row][col] = LoadOrZero(A, N, globalRow, tiledCol, M, N);
+					Bsub[row][col] = LoadOrZero(B, P, tiledRow, globalCol, N, P);
 					
 					/* Barrier to sync the read-write */
 					item.barrier(sycl::access::fence_space::local_space);
@@ -129,11 +223,14 @@ void MatrixMulTiled(sycl::queue& q,
 					item.barrier(sycl::access::fence_space::local_space);
 				}
 				/* Write from cache to host memory */
-				C[globalRow * M + globalCol] = acc;
+				if (globalRow < M && globalCol < P)
+					C[globalRow * P + globalCol] = acc;
 			});
 
 		});
 		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
 	}
 	catch (sycl::exception const& e) {
 		std::cout << "An exception is caught while multiplying matrices.\n";
@@ -144,31 +241,30 @@ void MatrixMulTiled(sycl::queue& q,
 //-----------------------------------------------------------------------------
 // Kernel-3: Increase WPT (Work per thread) 
 //-----------------------------------------------------------------------------
-void MatrixMulWPT(sycl::queue &q, 
-	size_t M, size_t N, size_t P,
-	float* a_host,
-	float* b_host,
-	float* c_gpu) {
-	PROFILE_FUNCTION("gflops");
+template <size_t TS, size_t WPT>
+void MatrixMulWPT(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	static_assert(TS % WPT == 0, "Tile size must be a multiple of WPT");
+	constexpr size_t RTS = TS / WPT;	// Reduced tile size
+
+	PROFILE_FUNCTION(Gflops);
 	try {
-		/* Create buffers */
-		sycl::buffer<float, 1> a(a_host, sycl::range<1>{M* N});
-		sycl::buffer<float, 1> b(b_host, sycl::range<1>{N* P});
-		sycl::buffer<float, 1> c(c_gpu, sycl::range<1>{M* P});
-
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
 
-		/* Submit to queue with buffer accessors */
-		auto e = q.submit([&](sycl::handler& h) {
-
-			auto A = a.template get_access<sycl::access::mode::read>(h);
-			auto B = b.template get_access<sycl::access::mode::read>(h);
-			auto C = c.template get_access<sycl::access::mode::write>(h);
+		/* Device-resident operands */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
 
+		/* Submit to queue, kernel captures the USM pointers */
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
 			/* Create cache reservations for workgroup */
 			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Asub(sycl::range<2>{TS, TS}, h);
 			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Bsub(sycl::range<2>{TS, TS}, h);
 
-			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{M, P/WPT}, sycl::range<2>{TS, RTS}), [=](sycl::nd_item<2> item) {
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{RoundUp(M, TS), RoundUp(P, TS) / WPT}, sycl::range<2>{TS, RTS}), [=](sycl::nd_item<2> item) {
 				/* Thread identifiers of work-item */
 				const int row = item.get_local_id(0); // 0-3 (1-TS)
 				const int col = item.get_local_id(1); // 0-1 (1-TS/WPT)
@@ -182,14 +278,14 @@ void MatrixMulWPT(sycl::queue &q,
 				for (int w = 0; w < WPT; w++) { acc[w] = 0; }
 
 				/* For all tiles */
-				const int num_tiles = N / TS;
+				const int num_tiles = CeilDiv(N, TS);
 				for (int t = 0; t < num_tiles; t++) {
 					/* Load a tile into cache for both A and B */
 					for (int w = 0; w < WPT; w++) {
 						const int tiledRow = TS * t + row;
 						const int tiledCol = TS * t + col;
-						Asub[row][col + w*RTS] = A[globalRow * N + tiledCol + w*RTS];
-						Bsub[row][col + w*RTS] = B[tiledRow * P + globalCol + w*RTS];
+						Asub[row][col + w*RTS] = LoadOrZero(A, N, globalRow, tiledCol + w*RTS, M, N);
+						Bsub[row][col + w*RTS] = LoadOrZero(B, P, tiledRow, globalCol + w*RTS, N, P);
 					}
 					/* cache-sync */
 					item.barrier(sycl::access::fence_space::local_space);
@@ -204,10 +300,13 @@ void MatrixMulWPT(sycl::queue &q,
 				}
 				/* store values to C */
 				for (int w = 0; w < WPT; w++)
-					C[globalRow * M + (globalCol + w*RTS)] = acc[w]; //?
+					if (globalRow < M && globalCol + w*RTS < P)
+						C[globalRow * P + (globalCol + w*RTS)] = acc[w];
 			});
 		});
 		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
 	}
 	catch (sycl::exception const &e) {
 		std::cout << "Exception occured while executing the kernel.\n";
@@ -218,29 +317,25 @@ void MatrixMulWPT(sycl::queue &q,
 //-----------------------------------------------------------------------------
 // Kernel-4: Increase width of datatype and WPT  
 //-----------------------------------------------------------------------------
-void MatrixMulWideWPT(sycl::queue& q,
-	size_t M, size_t N, size_t P,
-	float* a_host,
-	float* b_host,
-	float* c_gpu) {
+template <size_t TS, int WIDTH>
+void MatrixMulWideWPT(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	static_assert(TS % WIDTH == 0, "Tile size must be a multiple of WIDTH");
+	using floatX = sycl::vec<float, WIDTH>;
 	
-	PROFILE_FUNCTION("gflops");
+	PROFILE_FUNCTION(Gflops);
 	try {
-		/* Cast to wide floatX type */
-		floatX* a_hostX = reinterpret_cast<floatX*>(a_host);
-		floatX* b_hostX = reinterpret_cast<floatX*>(b_host);
-		
-		/* Create buffers */
-		sycl::buffer<floatX, 1> a(a_hostX, sycl::range<1>(M*N/WIDTH));
-		sycl::buffer<floatX, 1> b(b_hostX, sycl::range<1>(N*P/WIDTH));
-		sycl::buffer<floatX, 1> c(reinterpret_cast<floatX*>(c_gpu), sycl::range<1>(M*P/WIDTH));
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
 
-		auto e = q.submit([&](sycl::handler& h) {
-			/* Accessors */
-			auto A = a.template get_access<sycl::access::mode::read>(h);
-			auto B = b.template get_access<sycl::access::mode::read>(h);
-			auto C = c.template get_access<sycl::access::mode::write>(h);
+		/* Device-resident operands, read and written as floatX where rows allow it */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
+		const bool aligned = N % WIDTH == 0 && P % WIDTH == 0;
 
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
 			/* Local cache reservation for tiles */
 			sycl::accessor<floatX, 2, sycl::access::mode::read_write, sycl::access::target::local> 
 				Asub(sycl::range<2>{TS, TS / WIDTH}, h);
@@ -248,7 +343,7 @@ void MatrixMulWideWPT(sycl::queue& q,
 				Bsub(sycl::range<2>{TS, TS / WIDTH}, h);
 
 			/* Define the computation */
-			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{M, P / WIDTH}, sycl::range<2>{TS, TS / WIDTH}), [=](sycl::nd_item<2> item) {
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{RoundUp(M, TS), RoundUp(P, TS) / WIDTH}, sycl::range<2>{TS, TS / WIDTH}), [=](sycl::nd_item<2> item) {
 				/* Local thread identifiers */
 				const int row = item.get_local_id(0);
 				const int col = item.get_local_id(1);
@@ -257,86 +352,40 @@ void MatrixMulWideWPT(sycl::queue& q,
 				const int globalRow = TS * item.get_group().get_id(0) + row;
 				const int globalCol = (TS / WIDTH) * item.get_group().get_id(1) + col;
 
-				#if WIDTH == 1
-				floatX acc = 0;
-				#elif WIDTH == 2
-				floatX acc = { 0.0, 0.0 };
-				#elif WIDTH == 4
-				floatX acc = { 0.0, 0.0, 0.0, 0.0 };
-				#elif WIDTH == 8
-				floatX acc = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
-				#endif
+				floatX acc(0.0f);
 
 				/* Iterate over all tiles */
-				const int num_tiles = N / TS;
+				const int num_tiles = CeilDiv(N, TS);
 				for (int t = 0; t < num_tiles; t++) {
 					/* Load a tile in cache */
 					const int tiledRow = t * TS + row;
 					const int tiledCol = t * (TS / WIDTH) + col;
-					Asub[row][col] = A[globalRow * N / WIDTH + tiledCol];
-					Bsub[row][col] = B[tiledRow * P / WIDTH + globalCol];
+					Asub[row][col] = LoadWide<WIDTH>(A, N, globalRow, tiledCol * WIDTH, M, N, aligned);
+					Bsub[row][col] = LoadWide<WIDTH>(B, P, tiledRow, globalCol * WIDTH, N, P, aligned);
 
 					/* Synchronize */
 					item.barrier(sycl::access::fence_space::local_space);
 
 					/* Compute */
 					floatX vecA, vecB;
-					float valA;
 					for (int k = 0; k < TS / WIDTH; k++) {
 						vecA = Asub[row][k];
 						for (int w = 0; w < WIDTH; w++) {
+							/* Row (k*WIDTH + w) of Bsub scaled by lane w of A */
 							vecB = Bsub[k * WIDTH + w][col];
-							#if WIDTH == 1
-							// valB = vecB; // Try with and without this
-							acc = vecA * vecB;
-							#elif WIDTH == 2
-							switch (w) {
-							case 0: valA = vecA.x(); break;
-							case 1: valA = vecA.y(); break;
-							}
-							acc.x() += vecB.x() * valA;
-							acc.y() += vecB.y() * valA;
-							#elif WIDTH == 4
-							switch (w) {
-							case 0: valA = vecA.x(); break;
-							case 1: valA = vecA.y(); break;
-							case 2: valA = vecA.z(); break;
-							case 3: valA = vecA.w(); break;
-							}
-							acc.x() += vecB.x() * valA;
-							acc.y() += vecB.y() * valA;
-							acc.z() += vecB.z() * valA;
-							acc.w() += vecB.w() * valA;
-							#elif WIDTH == 8
-							switch (w) {
-							case 0: valA = vecA.s0(); break;
-							case 1: valA = vecA.s1(); break;
-							case 2: valA = vecA.s2(); break;
-							case 3: valA = vecA.s3(); break;
-							case 4: valA = vecA.s4(); break;
-							case 5: valA = vecA.s5(); break;
-							case 6: valA = vecA.s6(); break;
-							case 7: valA = vecA.s7(); break;
-							}
-							acc.s0() += vecB.s0() * valA;
-							acc.s1() += vecB.s1() * valA;
-							acc.s2() += vecB.s2() * valA;
-							acc.s3() += vecB.s3() * valA;
-							acc.s4() += vecB.s4() * valA;
-							acc.s5() += vecB.s5() * valA;
-							acc.s6() += vecB.s6() * valA;
-							acc.s7() += vecB.s7() * valA;
-							#endif
+							acc += vecB * vecA[w];
 						}
 					}
 					/* Synchronize */
 					item.barrier(sycl::access::fence_space::local_space);
 				}
 				/* writeback */
-				C[globalRow * P / WIDTH + globalCol] = acc;
+				StoreWide<WIDTH>(C, P, globalRow, globalCol * WIDTH, M, P, aligned, acc);
 				});
 			});
 		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
 	}
 	catch (const sycl::exception& e) {
 		std::cout << "Exception occured in WideWPT (Kernel #4)\n";
@@ -344,21 +393,459 @@ void MatrixMulWideWPT(sycl::queue& q,
 	}
 }
 
-// Function set to verify results of different kernels you implement
+//-----------------------------------------------------------------------------
+// Kernel-5: 2D register blocking. Each work-item computes a WPTM x WPTN block
+// of C as outer products of a column of Asub and a row of Bsub.
+// Tiles of A (TSM x TSK) and B (TSK x TSN) are larger than the thread grid.
+// The kernel is BLAS-general: C = alpha * op(A) * op(B) + beta * C with leading
+// dimensions. Transposes are resolved while loading the tiles.
+// Batches run in the first dimension of the nd_range: one launch per batch.
+//-----------------------------------------------------------------------------
+template <size_t TSM, size_t TSN, size_t TSK, size_t WPTM, size_t WPTN, typename Batch>
+sycl::event SgemmRegBlockBatched(sycl::queue& q, bool transA, bool transB,
+	size_t M, size_t P, size_t N,
+	float alpha,
+	const Batch& batch, size_t lda, size_t ldb,
+	float beta, size_t ldc,
+	size_t batch_count,
+	const std::vector<sycl::event>& deps = {}) {
+	static_assert(TSM % WPTM == 0 && TSN % WPTN == 0, "Tile sizes must be multiples of WPTM/WPTN");
+	constexpr size_t RTSM = TSM / WPTM;			// Threads along M
+	constexpr size_t RTSN = TSN / WPTN;			// Threads along N
+	constexpr size_t THREADS = RTSM * RTSN;
+	constexpr size_t LPTA = TSM * TSK / THREADS;	// Loads-per-thread for A
+	constexpr size_t LPTB = TSK * TSN / THREADS;	// Loads-per-thread for B
+	static_assert((TSM * TSK) % THREADS == 0 && (TSK * TSN) % THREADS == 0, "Tiles must split evenly over the threads");
+
+	try {
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+
+			/* Asub is stored transposed, so both tiles are read along TSK rows */
+			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Asub(sycl::range<2>{TSK, TSM}, h);
+			sycl::accessor<float, 2, sycl::access::mode::read_write, sycl::access::target::local> Bsub(sycl::range<2>{TSK, TSN}, h);
+
+			h.parallel_for(sycl::nd_range<3>(sycl::range<3>{batch_count, RoundUp(M, TSM) / WPTM, RoundUp(P, TSN) / WPTN}, sycl::range<3>{1, RTSM, RTSN}), [=](sycl::nd_item<3> item) {
+				/* Operands of this batch entry */
+				const float* A = batch.GetA(item.get_global_id(0));
+				const float* B = batch.GetB(item.get_global_id(0));
+				float* C = batch.GetC(item.get_global_id(0));
+
+				/* Thread identifiers inside the work-group */
+				const size_t tidm = item.get_local_id(1);
+				const size_t tidn = item.get_local_id(2);
+				const size_t tid = tidm * RTSN + tidn;
+
+				/* Top-left corner of this work-group's block of C */
+				const size_t offsetM = TSM * item.get_group().get_id(1);
+				const size_t offsetN = TSN * item.get_group().get_id(2);
+
+				/* Register block of C and register caches of A, B */
+				float acc[WPTM][WPTN];
+				float Areg;
+				float Breg[WPTN];
+				for (size_t wm = 0; wm < WPTM; wm++)
+					for (size_t wn = 0; wn < WPTN; wn++)
+						acc[wm][wn] = 0.0f;
+
+				const size_t num_tiles = CeilDiv(N, TSK);
+				for (size_t t = 0; t < num_tiles; t++) {
+					/* Cooperative load of both tiles. Consecutive threads always walk
+					   the contiguous dimension of the operand in memory, transposed or not */
+					for (size_t l = 0; l < LPTA; l++) {
+						const size_t id = tid + l * THREADS;
+						if (!transA) {
+							const size_t r = id / TSK, k = id % TSK;
+							Asub[k][r] = LoadOrZero(A, lda, offsetM + r, t * TSK + k, M, N);
+						}
+						else {
+							const size_t k = id / TSM, r = id % TSM;
+							Asub[k][r] = LoadOrZero(A, lda, t * TSK + k, offsetM + r, N, M);
+						}
+					}
+					for (size_t l = 0; l < LPTB; l++) {
+						const size_t id = tid + l * THREADS;
+						if (!transB) {
+							const size_t k = id / TSN, col = id % TSN;
+							Bsub[k][col] = LoadOrZero(B, ldb, t * TSK + k, offsetN + col, N, P);
+						}
+						else {
+							const size_t col = id / TSK, k = id % TSK;
+							Bsub[k][col] = LoadOrZero(B, ldb, offsetN + col, t * TSK + k, P, N);
+						}
+					}
+					item.barrier(sycl::access::fence_space::local_space);
+
+					/* Outer product of one column of Asub and one row of Bsub per k */
+					for (size_t k = 0; k < TSK; k++) {
+						for (size_t wn = 0; wn < WPTN; wn++)
+							Breg[wn] = Bsub[k][tidn + wn * RTSN];
+						for (size_t wm = 0; wm < WPTM; wm++) {
+							Areg = Asub[k][tidm + wm * RTSM];
+							for (size_t wn = 0; wn < WPTN; wn++)
+								acc[wm][wn] += Areg * Breg[wn];
+						}
+					}
+					item.barrier(sycl::access::fence_space::local_space);
+				}
+
+				/* Store the register block. beta == 0 never reads C (BLAS semantics) */
+				for (size_t wm = 0; wm < WPTM; wm++) {
+					const size_t globalRow = offsetM + tidm + wm * RTSM;
+					for (size_t wn = 0; wn < WPTN; wn++) {
+						const size_t globalCol = offsetN + tidn + wn * RTSN;
+						if (globalRow >= M || globalCol >= P)
+							continue;
+						float& out = C[globalRow * ldc + globalCol];
+						out = beta == 0.0f ? alpha * acc[wm][wn] : alpha * acc[wm][wn] + beta * out;
+					}
+				}
+			});
+		});
+	}
+	catch (const sycl::exception& e) {
+		std::cout << "Exception occured in RegBlock (Kernel #5)\n";
+		terminate();
+	}
+}
+
+template <size_t TSM, size_t TSN, size_t TSK, size_t WPTM, size_t WPTN>
+sycl::event SgemmRegBlock(sycl::queue& q, bool transA, bool transB,
+	size_t M, size_t P, size_t N,
+	float alpha,
+	const float* A, size_t lda,
+	const float* B, size_t ldb,
+	float beta,
+	float* C, size_t ldc,
+	const std::vector<sycl::event>& deps = {}) {
+	return SgemmRegBlockBatched<TSM, TSN, TSK, WPTM, WPTN>(q, transA, transB, M, P, N,
+		alpha, StridedBatch{ A, 0, B, 0, C, 0 }, lda, ldb, beta, ldc, 1, deps);
+}
+
+template <size_t TSM, size_t TSN, size_t TSK, size_t WPTM, size_t WPTN>
+void MatrixMulRegBlock(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	PROFILE_FUNCTION(Gflops);
+	const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+	sycl::event e = SgemmRegBlock<TSM, TSN, TSK, WPTM, WPTN>(ctx.Queue(), false, false, M, P, N,
+		1.0f, a.Data(), N, b.Data(), P, 0.0f, c.Data(), P);
+	e.wait();
+	PROFILE_EVENT(e);
+	PROFILE_FLOPS(2.0 * M * N * P);
+}
+
+//-----------------------------------------------------------------------------
+// Kernel-6: Double-buffered tiles. Tile t+1 is loaded into the second local
+// buffer while tile t is multiplied: one barrier per tile instead of two.
+// Variants of Kernel-2 (MatrixMulTiledPrefetch) and Kernel-3 (MatrixMulWPTPrefetch).
+//-----------------------------------------------------------------------------
+template <size_t TS>
+void MatrixMulTiledPrefetch(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	PROFILE_FUNCTION(Gflops);
+	try {
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+
+		/* Device-resident operands */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
+
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
+			/* Two tiles per operand: [buffer][row][col] */
+			sycl::accessor<float, 3, sycl::access::mode::read_write, sycl::access::target::local> Asub(sycl::range<3>{2, TS, TS}, h);
+			sycl::accessor<float, 3, sycl::access::mode::read_write, sycl::access::target::local> Bsub(sycl::range<3>{2, TS, TS}, h);
+
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>(RoundUp(M, TS), RoundUp(P, TS)), sycl::range<2>(TS, TS)), [=](sycl::nd_item<2> item) {
+				/* row, col thread identifier for each tile */
+				const size_t row = item.get_local_id(0);
+				const size_t col = item.get_local_id(1);
+
+				/* row, col thread identifer of C */
+				const size_t globalRow = TS * item.get_group().get_id(0) + row;
+				const size_t globalCol = TS * item.get_group().get_id(1) + col;
+
+				/* Prologue: first tile into buffer 0 */
+				Asub[0][row][col] = LoadOrZero(A, N, globalRow, col, M, N);
+				Bsub[0][row][col] = LoadOrZero(B, P, row, globalCol, N, P);
+				item.barrier(sycl::access::fence_space::local_space);
+
+				float acc = 0;
+				const size_t num_tiles = CeilDiv(N, TS);
+				for (size_t t = 0; t < num_tiles; t++) {
+					const size_t cur = t % 2;
+
+					/* Issue the loads of the next tile before computing on this one.
+					   The other buffer was last read before the previous barrier */
+					if (t + 1 < num_tiles) {
+						const size_t tiledRow = TS * (t + 1) + row;
+						const size_t tiledCol = TS * (t + 1) + col;
+						Asub[1 - cur][row][col] = LoadOrZero(A, N, globalRow, tiledCol, M, N);
+						Bsub[1 - cur][row][col] = LoadOrZero(B, P, tiledRow, globalCol, N, P);
+					}
+
+					for (size_t k = 0; k < TS; k++)
+						acc += Asub[cur][row][k] * Bsub[cur][k][col];
+
+					/* Next tile is visible and this one is free to overwrite */
+					item.barrier(sycl::access::fence_space::local_space);
+				}
+				if (globalRow < M && globalCol < P)
+					C[globalRow * P + globalCol] = acc;
+			});
+		});
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
+	}
+	catch (sycl::exception const& e) {
+		std::cout << "Exception occured in TiledPrefetch (Kernel #6)\n";
+		terminate();
+	}
+}
+
+template <size_t TS, size_t WPT>
+void MatrixMulWPTPrefetch(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	static_assert(TS % WPT == 0, "Tile size must be a multiple of WPT");
+	constexpr size_t RTS = TS / WPT;	// Reduced tile size
+
+	PROFILE_FUNCTION(Gflops);
+	try {
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+
+		/* Device-resident operands */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
+
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
+			/* Two tiles per operand: [buffer][row][col] */
+			sycl::accessor<float, 3, sycl::access::mode::read_write, sycl::access::target::local> Asub(sycl::range<3>{2, TS, TS}, h);
+			sycl::accessor<float, 3, sycl::access::mode::read_write, sycl::access::target::local> Bsub(sycl::range<3>{2, TS, TS}, h);
+
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{RoundUp(M, TS), RoundUp(P, TS) / WPT}, sycl::range<2>{TS, RTS}), [=](sycl::nd_item<2> item) {
+				/* Thread identifiers of work-item */
+				const size_t row = item.get_local_id(0);
+				const size_t col = item.get_local_id(1);
+
+				/* Thread identifiers across C */
+				const size_t globalRow = TS * item.get_group().get_id(0) + row;
+				const size_t globalCol = TS * item.get_group().get_id(1) + col;
+
+				/* Prologue: first tile into buffer 0 */
+				for (size_t w = 0; w < WPT; w++) {
+					Asub[0][row][col + w * RTS] = LoadOrZero(A, N, globalRow, col + w * RTS, M, N);
+					Bsub[0][row][col + w * RTS] = LoadOrZero(B, P, row, globalCol + w * RTS, N, P);
+				}
+				item.barrier(sycl::access::fence_space::local_space);
+
+				float acc[WPT];
+				for (size_t w = 0; w < WPT; w++) { acc[w] = 0; }
+
+				const size_t num_tiles = CeilDiv(N, TS);
+				for (size_t t = 0; t < num_tiles; t++) {
+					const size_t cur = t % 2;
+
+					/* Prefetch the next tile into the other buffer */
+					if (t + 1 < num_tiles) {
+						const size_t tiledRow = TS * (t + 1) + row;
+						const size_t tiledCol = TS * (t + 1) + col;
+						for (size_t w = 0; w < WPT; w++) {
+							Asub[1 - cur][row][col + w * RTS] = LoadOrZero(A, N, globalRow, tiledCol + w * RTS, M, N);
+							Bsub[1 - cur][row][col + w * RTS] = LoadOrZero(B, P, tiledRow, globalCol + w * RTS, N, P);
+						}
+					}
+
+					for (size_t k = 0; k < TS; k++) {
+						for (size_t w = 0; w < WPT; w++)
+							acc[w] += Asub[cur][row][k] * Bsub[cur][k][col + w * RTS];
+					}
+
+					/* Next tile is visible and this one is free to overwrite */
+					item.barrier(sycl::access::fence_space::local_space);
+				}
+				for (size_t w = 0; w < WPT; w++)
+					if (globalRow < M && globalCol + w * RTS < P)
+						C[globalRow * P + (globalCol + w * RTS)] = acc[w];
+			});
+		});
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
+	}
+	catch (sycl::exception const& e) {
+		std::cout << "Exception occured in WPTPrefetch (Kernel #6)\n";
+		terminate();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Kernel-7: Sub-group GEMM, no local memory and no work-group barriers.
+// A sub-group of SG lanes owns SG columns of C and WPT rows per lane. Lanes load
+// SG consecutive values of A and broadcast them. Every step of SG along the shared
+// dimension, each lane reloads SG values of its column of B from global memory
+// into registers. Those loads are coalesced across the lanes, but nothing shares
+// them: every sub-group along the rows of C reads the same B again.
+//-----------------------------------------------------------------------------
+template <size_t SG, size_t WPT>
+void MatrixMulSubGroup(nanoblas::Context& ctx,
+	const nanoblas::Matrix& a,
+	const nanoblas::Matrix& b,
+	nanoblas::Matrix& c) {
+	constexpr size_t SG_ROWS = 4;	// Sub-groups per work-group
+
+	PROFILE_FUNCTION(Gflops);
+	try {
+		const size_t M = a.Rows(), N = a.Cols(), P = b.Cols();
+
+		/* Device-resident operands */
+		const float* A = a.Data();
+		const float* B = b.Data();
+		float* C = c.Data();
+
+		auto e = ctx.Queue().submit([&](sycl::handler& h) {
+			/* Each row of the work-group is one sub-group along the columns of C */
+			h.parallel_for(sycl::nd_range<2>(sycl::range<2>{RoundUp(M, SG_ROWS * WPT) / WPT, RoundUp(P, SG)}, sycl::range<2>{SG_ROWS, SG}),
+				[=](sycl::nd_item<2> item) [[intel::reqd_sub_group_size(SG)]] {
+				sycl::sub_group sg = item.get_sub_group();
+				const size_t lane = sg.get_local_id()[0];
+
+				/* This lane's column and first row of C */
+				const size_t col = item.get_global_id(1);
+				const size_t row = item.get_global_id(0) * WPT;
+
+				float acc[WPT];
+				float Areg[WPT];
+				float Breg[SG];
+				for (size_t w = 0; w < WPT; w++) { acc[w] = 0; }
+
+				for (size_t k0 = 0; k0 < N; k0 += SG) {
+					/* Lane l holds A[row + w][k0 + l]: coalesced across the sub-group */
+					for (size_t w = 0; w < WPT; w++)
+						Areg[w] = LoadOrZero(A, N, row + w, k0 + lane, M, N);
+					/* The SG values of this lane's column of B */
+					for (size_t kk = 0; kk < SG; kk++)
+						Breg[kk] = LoadOrZero(B, P, k0 + kk, col, N, P);
+
+					/* A[row + w][k0 + kk] comes from lane kk */
+					for (size_t kk = 0; kk < SG; kk++)
+						for (size_t w = 0; w < WPT; w++)
+							acc[w] += sycl::group_broadcast(sg, Areg[w], kk) * Breg[kk];
+				}
+				for (size_t w = 0; w < WPT; w++)
+					if (row + w < M && col < P)
+						C[(row + w) * P + col] = acc[w];
+			});
+		});
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
+	}
+	catch (const sycl::exception& e) {
+		std::cout << "Exception occured in SubGroup (Kernel #7)\n";
+		terminate();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Default configurations (settings.h). Other configurations are picked at
+// runtime through nanoblas::Registry (registry.h).
+//-----------------------------------------------------------------------------
+void MatrixMulTiled(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulTiled<DEFAULT_TS>(ctx, a, b, c);
+}
+
+void MatrixMulWPT(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulWPT<DEFAULT_TS, DEFAULT_WPT>(ctx, a, b, c);
+}
+
+void MatrixMulWideWPT(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulWideWPT<DEFAULT_TS, DEFAULT_WIDTH>(ctx, a, b, c);
+}
+
+void MatrixMulRegBlock(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulRegBlock<DEFAULT_TSM, DEFAULT_TSN, DEFAULT_TSK, DEFAULT_WPTM, DEFAULT_WPTN>(ctx, a, b, c);
+}
+
+void MatrixMulTiledPrefetch(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulTiledPrefetch<DEFAULT_TS>(ctx, a, b, c);
+}
+
+void MatrixMulWPTPrefetch(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulWPTPrefetch<DEFAULT_TS, DEFAULT_WPT>(ctx, a, b, c);
+}
+
+void MatrixMulSubGroup(nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) {
+	MatrixMulSubGroup<DEFAULT_SG, DEFAULT_SG_WPT>(ctx, a, b, c);
+}
+
+//-----------------------------------------------------------------------------
+// Host-pointer entry points: upload A, B, run the kernel, download C.
+// Each call pays the full transfer. Keep operands in nanoblas::Matrix to avoid it.
+//-----------------------------------------------------------------------------
+template <typename Kernel>
+void MatrixMulFromHost(sycl::queue& q,
+	size_t M, size_t N, size_t P,
+	float* a_host,
+	float* b_host,
+	float* c_host,
+	Kernel kernel) {
+	nanoblas::Context ctx(q);
+	nanoblas::Matrix a(ctx, M, N, a_host);
+	nanoblas::Matrix b(ctx, N, P, b_host);
+	nanoblas::Matrix c(ctx, M, P);
+	kernel(ctx, a, b, c);
+	c.CopyToHost(c_host);
+}
+
+void MatrixMulParallelNaive(sycl::queue& q, size_t M, size_t N, size_t P, float* a_host, float* b_host, float* c_gpu) {
+	PROFILE_FUNCTION(Gflops);
+	MatrixMulFromHost(q, M, N, P, a_host, b_host, c_gpu,
+		[](nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) { MatrixMulParallelNaive(ctx, a, b, c); });
+}
+
+void MatrixMulTiled(sycl::queue& q, size_t M, size_t N, size_t P, float* a_host, float* b_host, float* c_gpu) {
+	PROFILE_FUNCTION(Gflops);
+	MatrixMulFromHost(q, M, N, P, a_host, b_host, c_gpu,
+		[](nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) { MatrixMulTiled(ctx, a, b, c); });
+}
+
+void MatrixMulWPT(sycl::queue& q, size_t M, size_t N, size_t P, float* a_host, float* b_host, float* c_gpu) {
+	PROFILE_FUNCTION(Gflops);
+	MatrixMulFromHost(q, M, N, P, a_host, b_host, c_gpu,
+		[](nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) { MatrixMulWPT(ctx, a, b, c); });
+}
+
+void MatrixMulWideWPT(sycl::queue& q, size_t M, size_t N, size_t P, float* a_host, float* b_host, float* c_gpu) {
+	PROFILE_FUNCTION(Gflops);
+	MatrixMulFromHost(q, M, N, P, a_host, b_host, c_gpu,
+		[](nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) { MatrixMulWideWPT(ctx, a, b, c); });
+}
+
+void MatrixMulRegBlock(sycl::queue& q, size_t M, size_t N, size_t P, float* a_host, float* b_host, float* c_gpu) {
+	PROFILE_FUNCTION(Gflops);
+	MatrixMulFromHost(q, M, N, P, a_host, b_host, c_gpu,
+		[](nanoblas::Context& ctx, const nanoblas::Matrix& a, const nanoblas::Matrix& b, nanoblas::Matrix& c) { MatrixMulRegBlock(ctx, a, b, c); });
+}
+
+// Function set to verify results of different kernels you implement.
+// Blocked, multithreaded host GEMM (cpu_gemm.h), c_host is overwritten
 void MatrixMulCPU(size_t M, size_t N, size_t P,
 				float *a_host,
 				float *b_host,
 				float *c_host) {
 
-	PROFILE_FUNCTION("gflops");
-	std::cout << "Computing CPU results...\n";
-	
-	for (size_t i = 0; i < M; i++) {
-		for (size_t k = 0; k < N; k++)
-			for (size_t j = 0; j < P; j++) {
-				c_host[i * M + j] += a_host[i * M + k] * b_host[k * N + j];
-		}
-	}
+	PROFILE_FUNCTION(Gflops);
+	std::cout << "Computing CPU results (" << nanoblas::cpu::IsaName(nanoblas::cpu::HostIsa()) << " micro-kernel)...\n";
+	nanoblas::cpu::sgemm(M, P, N, 1.0f, a_host, N, b_host, P, 0.0f, c_host, P);
+	PROFILE_FLOPS(2.0 * M * N * P);
 }
 
 void print_matrix(size_t R, size_t C, float* mat) {
@@ -372,31 +859,16 @@ void print_matrix(size_t R, size_t C, float* mat) {
 	}
 }
 
-void print_matrix(size_t R, size_t C, floatX* mat) {
+template <int WIDTH>
+void print_matrix(size_t R, size_t C, const sycl::vec<float, WIDTH>* mat) {
 	std::cout << "Printing wide matrix\n";
 	/* Width is across column */
 	C = C / WIDTH;
 	for (size_t i = 0; i < R; i++){
 		for (size_t j = 0; j < C; j++) {
-			#if WIDTH == 1
-			std::cout << mat[i * C + j] << ", ";
-			#elif WIDTH == 2
-			std::cout << "{ " 
-					<< mat[i * C + j].x() 
-					<< ", " 
-					<< mat[i * C + j].y() 
-					<< " }";
-			#elif WIDTH == 4
-			std::cout << "{ "
-				<< mat[i * C + j].x()
-				<< ", "
-				<< mat[i * C + j].y()
-				<< ", "
-				<< mat[i * C + j].z()
-				<< ", "
-				<< mat[i * C + j].w()
-				<< " }";
-			#endif
+			std::cout << "{ ";
+			for (int w = 0; w < WIDTH; w++)
+				std::cout << mat[i * C + j][w] << (w == WIDTH - 1 ? " }" : ", ");
 		}
 		std::cout << std::endl;
 	}
@@ -411,7 +883,7 @@ private:
 
 public:
 	static bool VerifyResult(size_t R, size_t C, T* c_gpu, T* c_host) {
-		PROFILE_FUNCTION("time");
+		PROFILE_FUNCTION(Time);
 		std::cout << "Comparing results of CPU and GPU.\n";
 
 		int errors = 0;
@@ -0,0 +1,112 @@
+#pragma once
+/*
+Philox4x32-10 counter-based RNG (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11).
+Every 4 random words are a pure function of (key, counter), so element i of a
+stream is the same whether it is produced by one host thread, many host threads
+or a device parallel_for. Same code runs on host and device.
+*/
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <CL/sycl.hpp>
+
+namespace nanoblas {
+	struct PhiloxBlock {
+		uint32_t x[4];
+	};
+
+	class Philox {
+		// One stream per (seed, stream) pair. Counter words 0-1 are the block index,
+		// word 2 is the stream id, so streams of the same seed never overlap
+	private:
+		static constexpr uint32_t M0 = 0xD2511F53;
+		static constexpr uint32_t M1 = 0xCD9E8D57;
+		static constexpr uint32_t W0 = 0x9E3779B9;		// Golden ratio
+		static constexpr uint32_t W1 = 0xBB67AE85;		// sqrt(3) - 1
+
+		uint32_t m_Key0, m_Key1;
+		uint32_t m_Stream;
+
+	public:
+		explicit Philox(uint64_t seed, uint32_t stream = 0)
+			: m_Key0(static_cast<uint32_t>(seed)), m_Key1(static_cast<uint32_t>(seed >> 32)), m_Stream(stream)
+		{
+
+		}
+
+		// Raw Philox4x32-10 of one counter under one key
+		static PhiloxBlock Generate(PhiloxBlock ctr, uint32_t k0, uint32_t k1) {
+			for (int round = 0; round < 10; round++) {
+				const uint64_t p0 = static_cast<uint64_t>(M0) * ctr.x[0];
+				const uint64_t p1 = static_cast<uint64_t>(M1) * ctr.x[2];
+				ctr = { {
+					static_cast<uint32_t>(p1 >> 32) ^ ctr.x[1] ^ k0,
+					static_cast<uint32_t>(p1),
+					static_cast<uint32_t>(p0 >> 32) ^ ctr.x[3] ^ k1,
+					static_cast<uint32_t>(p0) } };
+				k0 += W0;
+				k1 += W1;
+			}
+			return ctr;
+		}
+
+		// Words 4 * block .. 4 * block + 3 of this stream
+		PhiloxBlock operator()(uint64_t block) const {
+			return Generate({ { static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), m_Stream, 0 } }, m_Key0, m_Key1);
+		}
+
+		// Uniform float in [0, 1) from the top 24 bits
+		static float Uniform(uint32_t word) {
+			return (word >> 8) * (1.0f / 16777216.0f);
+		}
+	};
+
+	// out[i] = map(word i of the stream) for i < n, four elements per counter
+	template <typename T, typename Map>
+	inline void PhiloxFillBlock(const Philox& rng, T* out, size_t n, uint64_t block, Map map) {
+		const PhiloxBlock words = rng(block);
+		const size_t first = block * 4;
+		for (size_t w = 0; w < 4 && first + w < n; w++)
+			out[first + w] = map(words.x[w]);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Fill n elements on the host. Threads take contiguous ranges of counters, the
+	// result does not depend on the thread count. threads == 0 uses every hardware thread.
+	//-----------------------------------------------------------------------------
+	template <typename T, typename Map>
+	void PhiloxFillHost(const Philox& rng, T* out, size_t n, Map map, size_t threads = 0) {
+		const size_t blocks = (n + 3) / 4;
+		if (threads == 0)
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		threads = std::max<size_t>(1, std::min(threads, blocks));
+
+		auto worker = [&](size_t t) {
+			const size_t begin = blocks * t / threads;
+			const size_t end = blocks * (t + 1) / threads;
+			for (size_t block = begin; block < end; block++)
+				PhiloxFillBlock(rng, out, n, block, map);
+		};
+		std::vector<std::thread> pool;
+		for (size_t t = 1; t < threads; t++)
+			pool.emplace_back(worker, t);
+		worker(0);
+		for (auto& thread : pool)
+			thread.join();
+	}
+
+	// Same stream, filled on the device into USM memory. Does not wait
+	template <typename T, typename Map>
+	sycl::event PhiloxFillDevice(sycl::queue& q, const Philox& rng, T* out, size_t n, Map map,
+		const std::vector<sycl::event>& deps = {}) {
+		const size_t blocks = (n + 3) / 4;
+		return q.submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			h.parallel_for(sycl::range<1>{ blocks }, [=](sycl::id<1> id) {
+				PhiloxFillBlock(rng, out, n, id[0], map);
+			});
+		});
+	}
+}
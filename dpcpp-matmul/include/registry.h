@@ -0,0 +1,223 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "matrix.h"
+#include "nanoblas.h"
+#include "settings.h"
+
+namespace nanoblas {
+	enum class KernelId { Naive, Tiled, WPT, WideWPT, RegBlock, TiledPrefetch, WPTPrefetch, SubGroup };
+
+	inline const char* KernelName(KernelId id) {
+		switch (id) {
+		case KernelId::Naive: return "naive";
+		case KernelId::Tiled: return "tiled";
+		case KernelId::WPT: return "wpt";
+		case KernelId::WideWPT: return "wide";
+		case KernelId::RegBlock: return "reg";
+		case KernelId::TiledPrefetch: return "tiled_db";
+		case KernelId::WPTPrefetch: return "wpt_db";
+		case KernelId::SubGroup: return "subgroup";
+		}
+		return "unknown";
+	}
+
+	struct GemmConfig {
+		// One compiled-in instantiation of a kernel template
+		KernelId Kernel;
+		size_t TS;			// TSM for RegBlock, sub-group size for SubGroup
+		size_t WPT;			// WPTM for RegBlock
+		int Width;
+		size_t TSN = 0;		// RegBlock only
+		size_t TSK = 0;		// RegBlock only
+		size_t WPTN = 0;	// RegBlock only
+
+		// Unique, human readable key. Eg: "wpt_ts16_wpt4", "wide_ts32_w8", "reg_64x64x16_8x8", "wpt_db_ts16_wpt2"
+		std::string Name() const {
+			std::string name = KernelName(Kernel);
+			if (Kernel == KernelId::Naive)
+				return name;
+			if (Kernel == KernelId::SubGroup)
+				return name + "_sg" + std::to_string(TS) + "_wpt" + std::to_string(WPT);
+			if (Kernel == KernelId::RegBlock)
+				return name + "_" + std::to_string(TS) + "x" + std::to_string(TSN) + "x" + std::to_string(TSK)
+					+ "_" + std::to_string(WPT) + "x" + std::to_string(WPTN);
+			name += "_ts" + std::to_string(TS);
+			if (Kernel == KernelId::WPT || Kernel == KernelId::WPTPrefetch)
+				name += "_wpt" + std::to_string(WPT);
+			if (Kernel == KernelId::WideWPT)
+				name += "_w" + std::to_string(Width);
+			return name;
+		}
+
+		// Work-items in one work-group of this configuration
+		size_t WorkGroupSize() const {
+			switch (Kernel) {
+			case KernelId::Tiled:
+			case KernelId::TiledPrefetch: return TS * TS;
+			case KernelId::WPT:
+			case KernelId::WPTPrefetch: return TS * (TS / WPT);
+			case KernelId::WideWPT: return TS * (TS / Width);
+			case KernelId::RegBlock: return (TS / WPT) * (TSN / WPTN);
+			case KernelId::SubGroup: return 4 * TS;
+			default: return 1;
+			}
+		}
+
+		// Local memory reserved per work-group (Asub + Bsub)
+		size_t LocalMemBytes() const {
+			switch (Kernel) {
+			case KernelId::Naive:
+			case KernelId::SubGroup: return 0;
+			case KernelId::RegBlock: return TSK * (TS + TSN) * sizeof(float);
+			case KernelId::TiledPrefetch:
+			case KernelId::WPTPrefetch: return 4 * TS * TS * sizeof(float);
+			default: return 2 * TS * TS * sizeof(float);
+			}
+		}
+
+		// Rows and columns of C that share one load of their A and B values
+		size_t TileRows() const {
+			switch (Kernel) {
+			case KernelId::Naive: return 1;
+			case KernelId::SubGroup: return WPT;
+			default: return TS;
+			}
+		}
+
+		size_t TileCols() const {
+			switch (Kernel) {
+			case KernelId::Naive: return 1;
+			case KernelId::RegBlock: return TSN;
+			default: return TS;
+			}
+		}
+
+		// Modeled global memory traffic of C = A * B, caches ignored: A is read once per
+		// tile column of C, B once per tile row, C written once. Ragged tiles count in full
+		double GlobalBytes(size_t M, size_t N, size_t P) const {
+			const double tilesM = static_cast<double>(RoundUp(M, TileRows()) / TileRows());
+			const double tilesP = static_cast<double>(RoundUp(P, TileCols()) / TileCols());
+			return sizeof(float) * (static_cast<double>(M) * N * tilesP + static_cast<double>(N) * P * tilesM + static_cast<double>(M) * P);
+		}
+
+		// One multiply and one add per inner product term
+		static double Flops(size_t M, size_t N, size_t P) {
+			return 2.0 * M * N * P;
+		}
+	};
+
+	// Configuration a kernel runs with when none is selected (settings.h)
+	inline GemmConfig DefaultConfig(KernelId kernel) {
+		switch (kernel) {
+		case KernelId::Naive: return { KernelId::Naive, 1, 1, 1 };
+		case KernelId::Tiled: return { KernelId::Tiled, DEFAULT_TS, 1, 1 };
+		case KernelId::WPT: return { KernelId::WPT, DEFAULT_TS, DEFAULT_WPT, 1 };
+		case KernelId::WideWPT: return { KernelId::WideWPT, DEFAULT_TS, 1, DEFAULT_WIDTH };
+		case KernelId::RegBlock: return { KernelId::RegBlock, DEFAULT_TSM, DEFAULT_WPTM, 1, DEFAULT_TSN, DEFAULT_TSK, DEFAULT_WPTN };
+		case KernelId::TiledPrefetch: return { KernelId::TiledPrefetch, DEFAULT_TS, 1, 1 };
+		case KernelId::WPTPrefetch: return { KernelId::WPTPrefetch, DEFAULT_TS, DEFAULT_WPT, 1 };
+		case KernelId::SubGroup: return { KernelId::SubGroup, DEFAULT_SG, DEFAULT_SG_WPT, 1 };
+		}
+		return { KernelId::Naive, 1, 1, 1 };
+	}
+
+	using GemmFn = void(*)(Context&, const Matrix&, const Matrix&, Matrix&);
+
+	struct GemmEntry {
+		GemmConfig Config;
+		GemmFn Fn;
+
+		void operator()(Context& ctx, const Matrix& a, const Matrix& b, Matrix& c) const { Fn(ctx, a, b, c); }
+	};
+
+	class Registry {
+		// Dispatch table of every kernel configuration instantiated at compile time.
+		// Add a configuration to the lists in the constructor to make it selectable.
+	private:
+		std::vector<GemmEntry> m_Entries;
+
+		Registry() {
+			Add({ KernelId::Naive, 1, 1, 1 }, &MatrixMulParallelNaive);
+			AddTiled<8, 16, 32>();
+			AddWPT<8, 2, 4, 8>();
+			AddWPT<16, 2, 4, 8>();
+			AddWPT<32, 4, 8>();
+			AddWideWPT<8, 1, 2, 4, 8>();
+			AddWideWPT<16, 1, 2, 4, 8>();
+			AddWideWPT<32, 2, 4, 8>();
+			AddRegBlock<32, 32, 16, 4, 4>();
+			AddRegBlock<64, 64, 8, 4, 4>();
+			AddRegBlock<64, 64, 16, 8, 8>();
+			AddRegBlock<128, 128, 8, 8, 8>();
+			AddTiledPrefetch<8, 16, 32>();
+			AddWPTPrefetch<8, 2, 4, 8>();
+			AddWPTPrefetch<16, 2, 4, 8>();
+			AddWPTPrefetch<32, 4, 8>();
+			AddSubGroup<8, 4, 8>();
+			AddSubGroup<16, 4, 8>();
+			AddSubGroup<32, 4, 8>();
+		}
+
+		void Add(const GemmConfig& config, GemmFn fn) {
+			m_Entries.push_back({ config, fn });
+		}
+
+		template <size_t... TSs>
+		void AddTiled() {
+			(Add({ KernelId::Tiled, TSs, 1, 1 }, &MatrixMulTiled<TSs>), ...);
+		}
+
+		template <size_t TS, size_t... WPTs>
+		void AddWPT() {
+			(Add({ KernelId::WPT, TS, WPTs, 1 }, &MatrixMulWPT<TS, WPTs>), ...);
+		}
+
+		template <size_t TS, int... Widths>
+		void AddWideWPT() {
+			(Add({ KernelId::WideWPT, TS, 1, Widths }, &MatrixMulWideWPT<TS, Widths>), ...);
+		}
+
+		template <size_t... TSs>
+		void AddTiledPrefetch() {
+			(Add({ KernelId::TiledPrefetch, TSs, 1, 1 }, &MatrixMulTiledPrefetch<TSs>), ...);
+		}
+
+		template <size_t TS, size_t... WPTs>
+		void AddWPTPrefetch() {
+			(Add({ KernelId::WPTPrefetch, TS, WPTs, 1 }, &MatrixMulWPTPrefetch<TS, WPTs>), ...);
+		}
+
+		template <size_t SG, size_t... WPTs>
+		void AddSubGroup() {
+			(Add({ KernelId::SubGroup, SG, WPTs, 1 }, &MatrixMulSubGroup<SG, WPTs>), ...);
+		}
+
+		template <size_t TSM, size_t TSN, size_t TSK, size_t WPTM, size_t WPTN>
+		void AddRegBlock() {
+			Add({ KernelId::RegBlock, TSM, WPTM, 1, TSN, TSK, WPTN }, &MatrixMulRegBlock<TSM, TSN, TSK, WPTM, WPTN>);
+		}
+
+	public:
+		const std::vector<GemmEntry>& Entries() const { return m_Entries; }
+
+		// nullptr if no configuration matches
+		const GemmEntry* Find(const std::string& name) const {
+			for (const GemmEntry& entry : m_Entries)
+				if (entry.Config.Name() == name)
+					return &entry;
+			return nullptr;
+		}
+
+		void Print() const {
+			std::cout << "Available configurations:\n";
+			for (const GemmEntry& entry : m_Entries)
+				std::cout << "\t" << entry.Config.Name() << "\n";
+		}
+
+		static Registry& Get() {
+			static Registry* instance = new Registry();
+			return *instance;
+		}
+	};
+}
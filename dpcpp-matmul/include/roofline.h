@@ -0,0 +1,190 @@
+#pragma once
+/*
+Roofline model (Williams et al., "Roofline: An Insightful Visual Performance Model", CACM 2009).
+Attainable GFLOPS = min(peak GFLOPS, arithmetic intensity * sustained GB/s), where
+arithmetic intensity is FLOPs per byte of global memory traffic.
+Peaks are measured on the device itself, traffic comes from each kernel's model (registry.h).
+*/
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "matrix.h"
+#include "registry.h"
+
+namespace nanoblas {
+	struct DevicePeaks {
+		double GBps;		// Sustained global memory bandwidth (device copy)
+		double GFLOPS;		// Peak single precision FMA throughput
+
+		// Intensity (FLOP/byte) above which a kernel can be compute bound
+		double Ridge() const { return GFLOPS / GBps; }
+
+		double Attainable(double intensity) const { return std::min(GFLOPS, intensity * GBps); }
+	};
+
+	// Execution time of a completed command, host wall time of `wall` if the queue does not profile
+	inline double EventSeconds(const sycl::event& e, double wall) {
+		try {
+			const auto start = e.get_profiling_info<sycl::info::event_profiling::command_start>();
+			const auto end = e.get_profiling_info<sycl::info::event_profiling::command_end>();
+			return (end - start) * 1e-9;
+		}
+		catch (sycl::exception const&) {
+			return wall;
+		}
+	}
+
+	// Best of `reps` runs of `submit`, which enqueues one command and returns its event
+	template <typename Submit>
+	double BestSeconds(Submit submit, int reps) {
+		submit().wait();	// JIT and first touch
+		double best = 0;
+		for (int r = 0; r < reps; r++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			sycl::event e = submit();
+			e.wait();
+			auto end = std::chrono::high_resolution_clock::now();
+			const double seconds = EventSeconds(e, std::chrono::duration<double>(end - start).count());
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		return best;
+	}
+
+	// Device time the pfr trace recorded during `call`, its wall time when nothing was recorded
+	template <typename Call>
+	double KernelSeconds(Call call) {
+		const double device = pfr::Instrumentor::Get().DeviceSeconds();
+		auto start = std::chrono::high_resolution_clock::now();
+		call();
+		auto end = std::chrono::high_resolution_clock::now();
+		const double seconds = pfr::Instrumentor::Get().DeviceSeconds() - device;
+		return seconds > 0 ? seconds : std::chrono::duration<double>(end - start).count();
+	}
+
+	//-----------------------------------------------------------------------------
+	// Micro-benchmarks for the two roofs.
+	// Bandwidth: float4 copy between two device buffers of `bytes` each (read + write counted).
+	// FLOPs: independent FMA chains per work-item, no memory traffic but one store.
+	//-----------------------------------------------------------------------------
+	inline DevicePeaks MeasurePeaks(Context& ctx, size_t bytes = 256 << 20, int reps = 5) {
+		PROFILE_FUNCTION(Time);
+		constexpr size_t CHAINS = 8;
+		constexpr size_t ITERS = 1024;
+		constexpr size_t ITEMS = 1 << 20;
+
+		const sycl::device device = ctx.Device();
+		bytes = std::min<size_t>(bytes, device.get_info<sycl::info::device::max_mem_alloc_size>());
+		bytes = std::min<size_t>(bytes, device.get_info<sycl::info::device::global_mem_size>() / 4);
+		const size_t count = bytes / sizeof(sycl::float4);
+		const size_t wg = std::min<size_t>(256, device.get_info<sycl::info::device::max_work_group_size>());
+
+		float* src = ctx.Allocate(count * 4);
+		float* dst = ctx.Allocate(std::max(count * 4, ITEMS));
+		ctx.Queue().fill(src, 1.0f, count * 4).wait();
+
+		const double copy = BestSeconds([&]() {
+			const sycl::float4* in = reinterpret_cast<const sycl::float4*>(src);
+			sycl::float4* out = reinterpret_cast<sycl::float4*>(dst);
+			return ctx.Queue().parallel_for(sycl::range<1>{ count }, [=](sycl::id<1> i) {
+				out[i] = in[i];
+			});
+		}, reps);
+
+		const double fma = BestSeconds([&]() {
+			float* out = dst;
+			return ctx.Queue().parallel_for(sycl::nd_range<1>{ ITEMS, wg }, [=](sycl::nd_item<1> item) {
+				const size_t i = item.get_global_id(0);
+				float acc[CHAINS];
+				for (size_t c = 0; c < CHAINS; c++)
+					acc[c] = static_cast<float>(i + c);
+				/* Independent chains hide the FMA latency */
+				for (size_t it = 0; it < ITERS; it++)
+					for (size_t c = 0; c < CHAINS; c++)
+						acc[c] = sycl::fma(acc[c], 0.999f, 0.001f);
+				float sum = 0;
+				for (size_t c = 0; c < CHAINS; c++)
+					sum += acc[c];
+				out[i] = sum;
+			});
+		}, reps);
+
+		ctx.Free(src);
+		ctx.Free(dst);
+		return { 2.0 * count * sizeof(sycl::float4) * 1e-9 / copy, 2.0 * ITEMS * CHAINS * ITERS * 1e-9 / fma };
+	}
+
+	class RooflineReport {
+		// One row per timed run: modeled traffic and FLOPs against the measured roofs.
+		// Printed to a stream and written as CSV next to the pfr trace.
+	private:
+		struct Run {
+			std::string Name;
+			size_t M, N, P;
+			double Bytes, Flops, Seconds;
+
+			double Intensity() const { return Flops / Bytes; }
+			double GBps() const { return Bytes * 1e-9 / Seconds; }
+			double GFLOPS() const { return Flops * 1e-9 / Seconds; }
+		};
+
+		DevicePeaks m_Peaks;
+		std::vector<Run> m_Runs;
+
+	public:
+		explicit RooflineReport(const DevicePeaks& peaks)
+			: m_Peaks(peaks)
+		{
+
+		}
+
+		void Add(const std::string& name, size_t M, size_t N, size_t P, double bytes, double flops, double seconds) {
+			if (seconds <= 0 || bytes <= 0)
+				return;
+			m_Runs.push_back({ name, M, N, P, bytes, flops, seconds });
+		}
+
+		// A registry configuration run on C[M, P] = A[M, N] * B[N, P]
+		void Add(const GemmConfig& config, size_t M, size_t N, size_t P, double seconds) {
+			Add(config.Name(), M, N, P, config.GlobalBytes(M, N, P), GemmConfig::Flops(M, N, P), seconds);
+		}
+
+		void Print(std::ostream& out = std::cout) const {
+			out << "[ROOFLINE] " << m_Peaks.GBps << " GB/s, " << m_Peaks.GFLOPS << " GFLOPS, ridge at "
+				<< m_Peaks.Ridge() << " FLOP/byte\n";
+			out << std::left << std::setw(24) << "kernel" << std::right
+				<< std::setw(10) << "FLOP/B" << std::setw(10) << "GB/s" << std::setw(10) << "GFLOPS"
+				<< std::setw(10) << "roof" << std::setw(10) << "% roof" << "  bound\n";
+			const std::streamsize precision = out.precision();
+			for (const Run& run : m_Runs) {
+				const double roof = m_Peaks.Attainable(run.Intensity());
+				out << std::left << std::setw(24) << run.Name << std::right << std::fixed << std::setprecision(2)
+					<< std::setw(10) << run.Intensity() << std::setw(10) << run.GBps() << std::setw(10) << run.GFLOPS()
+					<< std::setw(10) << roof << std::setw(10) << 100.0 * run.GFLOPS() / roof
+					<< "  " << (run.Intensity() < m_Peaks.Ridge() ? "memory" : "compute") << "\n";
+				out.unsetf(std::ios::floatfield);
+			}
+			out.precision(precision);
+		}
+
+		bool WriteCsv(const std::string& path) const {
+			std::ofstream out(path);
+			if (!out) {
+				std::cout << "[ERROR] Can not open " << path << " for writing.\n";
+				return false;
+			}
+			out << "kernel,M,N,P,seconds,bytes,flops,intensity,gbps,gflops,peak_gbps,peak_gflops,roof_gflops,fraction_of_roof\n";
+			for (const Run& run : m_Runs) {
+				const double roof = m_Peaks.Attainable(run.Intensity());
+				out << run.Name << "," << run.M << "," << run.N << "," << run.P << "," << run.Seconds << ","
+					<< run.Bytes << "," << run.Flops << "," << run.Intensity() << "," << run.GBps() << "," << run.GFLOPS() << ","
+					<< m_Peaks.GBps << "," << m_Peaks.GFLOPS << "," << roof << "," << run.GFLOPS() / roof << "\n";
+			}
+			return true;
+		}
+	};
+}
@@ -1,22 +1,33 @@
 #pragma once
+#include <cstddef>
 
 #define SIZE 4096
 
+/*
+Default kernel configuration. Kernels are templates over these parameters,
+every configuration listed in registry.h is compiled in and can be picked at runtime.
+*/
+
 // For kernels 2, 3, 4
-#define TS 16				// Tile Size
-
-// For kernel 3 
-#define WPT 2				// Work-per-Thread
-#define RTS TS/WPT			// Reduced tile size
-
-// For kernel 4 (wider load/stores)
-#define WIDTH 2
-#if WIDTH == 1
-typedef float floatX;
-#elif WIDTH == 2
-typedef sycl::float2 floatX;
-#elif WIDTH == 4
-typedef sycl::float4 floatX;
-#elif WIDTH == 8
-typedef sycl::float8 floatX;
-#endif
+constexpr size_t DEFAULT_TS = 16;		// Tile Size
+
+// For kernel 3 (reduced tile size is TS/WPT)
+constexpr size_t DEFAULT_WPT = 2;		// Work-per-Thread
+
+// For kernel 4 (wider load/stores): sycl::vec<float, WIDTH>
+constexpr int DEFAULT_WIDTH = 2;
+
+// For kernel 5 (2D register blocking): tile of C is TSM x TSN, inner tile TSK.
+// Each work-item computes WPTM x WPTN outputs
+constexpr size_t DEFAULT_TSM = 64;
+constexpr size_t DEFAULT_TSN = 64;
+constexpr size_t DEFAULT_TSK = 16;
+constexpr size_t DEFAULT_WPTM = 8;
+constexpr size_t DEFAULT_WPTN = 8;
+
+// For kernel 7 (sub-group broadcast): lanes per sub-group and rows of C per lane
+constexpr size_t DEFAULT_SG = 16;
+constexpr size_t DEFAULT_SG_WPT = 4;
+
+// Out-of-core GEMM: share of the device's global memory the streamed panels may use
+constexpr double DEFAULT_STREAM_MEM_FRACTION = 0.5;
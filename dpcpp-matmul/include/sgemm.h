@@ -0,0 +1,230 @@
+#pragma once
+#include <vector>
+#include "matrix.h"
+#include "nanoblas.h"
+
+namespace nanoblas {
+	enum class Transpose { None, Trans };
+
+	// Stored A is [M x N] or [N x M], stored B is [N x P] or [P x N]
+	inline bool ValidLeadingDims(bool tA, bool tB, size_t M, size_t P, size_t N, size_t lda, size_t ldb, size_t ldc) {
+		if (lda < (tA ? M : N) || ldb < (tB ? N : P) || ldc < P) {
+			std::cout << "[ERROR] sgemm: leading dimension smaller than the row length.\n";
+			return false;
+		}
+		return true;
+	}
+
+	// Completes once all deps have, for calls that have nothing to launch.
+	// Keeps the returned event a valid dependency for the rest of a chain
+	inline sycl::event Join(Context& ctx, const std::vector<sycl::event>& deps) {
+		return ctx.Queue().submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			h.single_task([]() {});
+		});
+	}
+
+	// Edge tiles are predicated on the device, any shape can use the tiled kernel.
+	// Pick the largest tiling that is not mostly padding, else the naive kernel
+	template <typename Batch>
+	sycl::event SgemmDispatch(Context& ctx, bool tA, bool tB,
+		size_t M, size_t P, size_t N,
+		float alpha, const Batch& batch, size_t lda, size_t ldb,
+		float beta, size_t ldc, size_t batch_count,
+		const std::vector<sycl::event>& deps) {
+		if (M == 0 || P == 0 || batch_count == 0)
+			return Join(ctx, deps);
+		if (M >= DEFAULT_TSM && P >= DEFAULT_TSN)
+			return SgemmRegBlockBatched<DEFAULT_TSM, DEFAULT_TSN, DEFAULT_TSK, DEFAULT_WPTM, DEFAULT_WPTN>(
+				ctx.Queue(), tA, tB, M, P, N, alpha, batch, lda, ldb, beta, ldc, batch_count, deps);
+		if (M >= 32 && P >= 32)
+			return SgemmRegBlockBatched<32, 32, 16, 4, 4>(ctx.Queue(), tA, tB, M, P, N, alpha, batch, lda, ldb, beta, ldc, batch_count, deps);
+		return SgemmNaiveBatched(ctx.Queue(), tA, tB, M, P, N, alpha, batch, lda, ldb, beta, ldc, batch_count, deps);
+	}
+
+	//-----------------------------------------------------------------------------
+	// BLAS-style SGEMM on row-major, device-resident (USM) operands:
+	//	C[M x P] = alpha * op(A)[M x N] * op(B)[N x P] + beta * C
+	// lda/ldb/ldc are the row strides of A, B, C as stored, so sub-blocks of larger
+	// matrices are multiplied in place (pass Data() + row * ld + col).
+	// As in BLAS, C is not read when beta == 0.
+	//
+	// *_async forms start after deps, return the GEMM's event and never wait:
+	//	auto e1 = sgemm_async(ctx, ..., A, B, ..., C);
+	//	auto e2 = sgemm_async(ctx, ..., C, D, ..., E, { e1 });
+	// The blocking forms are the same call followed by wait().
+	//-----------------------------------------------------------------------------
+	sycl::event sgemm_async(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda,
+		const float* B, size_t ldb,
+		float beta,
+		float* C, size_t ldc,
+		const std::vector<sycl::event>& deps = {}) {
+		const bool tA = transA == Transpose::Trans;
+		const bool tB = transB == Transpose::Trans;
+		if (!ValidLeadingDims(tA, tB, M, P, N, lda, ldb, ldc))
+			return Join(ctx, deps);
+		return SgemmDispatch(ctx, tA, tB, M, P, N, alpha, StridedBatch{ A, 0, B, 0, C, 0 }, lda, ldb, beta, ldc, 1, deps);
+	}
+
+	void sgemm(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda,
+		const float* B, size_t ldb,
+		float beta,
+		float* C, size_t ldc) {
+		PROFILE_FUNCTION(Gflops);
+		sycl::event e = sgemm_async(ctx, transA, transB, M, P, N, alpha, A, lda, B, ldb, beta, C, ldc);
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Batched SGEMM: batch_count independent GEMMs of the same shape in a single
+	// kernel launch (batch index is the first nd_range dimension).
+	// Strided: entry b uses A + b * strideA, B + b * strideB, C + b * strideC.
+	//-----------------------------------------------------------------------------
+	sycl::event sgemm_strided_batched_async(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda, size_t strideA,
+		const float* B, size_t ldb, size_t strideB,
+		float beta,
+		float* C, size_t ldc, size_t strideC,
+		size_t batch_count,
+		const std::vector<sycl::event>& deps = {}) {
+		const bool tA = transA == Transpose::Trans;
+		const bool tB = transB == Transpose::Trans;
+		if (!ValidLeadingDims(tA, tB, M, P, N, lda, ldb, ldc))
+			return Join(ctx, deps);
+		return SgemmDispatch(ctx, tA, tB, M, P, N, alpha, StridedBatch{ A, strideA, B, strideB, C, strideC }, lda, ldb, beta, ldc, batch_count, deps);
+	}
+
+	void sgemm_strided_batched(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda, size_t strideA,
+		const float* B, size_t ldb, size_t strideB,
+		float beta,
+		float* C, size_t ldc, size_t strideC,
+		size_t batch_count) {
+		PROFILE_FUNCTION(Time);
+		sycl::event e = sgemm_strided_batched_async(ctx, transA, transB, M, P, N, alpha, A, lda, strideA, B, ldb, strideB,
+			beta, C, ldc, strideC, batch_count);
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P * batch_count);
+	}
+
+	// Pointer arrays: entry b uses A[b], B[b], C[b]. The arrays themselves must be
+	// USM allocations the device can read (malloc_device/malloc_shared)
+	sycl::event sgemm_batched_async(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* const* A, size_t lda,
+		const float* const* B, size_t ldb,
+		float beta,
+		float* const* C, size_t ldc,
+		size_t batch_count,
+		const std::vector<sycl::event>& deps = {}) {
+		const bool tA = transA == Transpose::Trans;
+		const bool tB = transB == Transpose::Trans;
+		if (!ValidLeadingDims(tA, tB, M, P, N, lda, ldb, ldc))
+			return Join(ctx, deps);
+		return SgemmDispatch(ctx, tA, tB, M, P, N, alpha, PointerArrayBatch{ A, B, C }, lda, ldb, beta, ldc, batch_count, deps);
+	}
+
+	void sgemm_batched(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* const* A, size_t lda,
+		const float* const* B, size_t ldb,
+		float beta,
+		float* const* C, size_t ldc,
+		size_t batch_count) {
+		PROFILE_FUNCTION(Time);
+		sycl::event e = sgemm_batched_async(ctx, transA, transB, M, P, N, alpha, A, lda, B, ldb, beta, C, ldc, batch_count);
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * M * N * P * batch_count);
+	}
+
+	// Whole-matrix form: shapes and leading dimensions come from the Matrix objects
+	sycl::event sgemm_async(Context& ctx, Transpose transA, Transpose transB,
+		float alpha, const Matrix& a, const Matrix& b,
+		float beta, Matrix& c,
+		const std::vector<sycl::event>& deps = {}) {
+		const size_t M = transA == Transpose::Trans ? a.Cols() : a.Rows();
+		const size_t N = transA == Transpose::Trans ? a.Rows() : a.Cols();
+		const size_t P = transB == Transpose::Trans ? b.Rows() : b.Cols();
+		const size_t NB = transB == Transpose::Trans ? b.Cols() : b.Rows();
+		if (N != NB || c.Rows() != M || c.Cols() != P) {
+			std::cout << "[ERROR] sgemm: operand shapes do not match.\n";
+			return Join(ctx, deps);
+		}
+		return sgemm_async(ctx, transA, transB, M, P, N, alpha, a.Data(), a.Cols(), b.Data(), b.Cols(), beta, c.Data(), c.Cols(), deps);
+	}
+
+	void sgemm(Context& ctx, Transpose transA, Transpose transB,
+		float alpha, const Matrix& a, const Matrix& b,
+		float beta, Matrix& c) {
+		PROFILE_FUNCTION(Gflops);
+		sycl::event e = sgemm_async(ctx, transA, transB, alpha, a, b, beta, c);
+		e.wait();
+		PROFILE_EVENT(e);
+		PROFILE_FLOPS(2.0 * c.Rows() * (transA == Transpose::Trans ? a.Rows() : a.Cols()) * c.Cols());
+	}
+
+	//-----------------------------------------------------------------------------
+	// Elementwise matrix add with optional transposes (BLAS-like extension):
+	//	C[M x P] = alpha * op(A) + beta * op(B)
+	// Covers scaling (beta = 0), add/subtract and out-of-place transpose.
+	// B is not read when beta == 0. C may alias A or B only if that operand is not transposed.
+	//-----------------------------------------------------------------------------
+	sycl::event sgeam_async(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P,
+		float alpha, const float* A, size_t lda,
+		float beta, const float* B, size_t ldb,
+		float* C, size_t ldc,
+		const std::vector<sycl::event>& deps = {}) {
+		const bool tA = transA == Transpose::Trans;
+		const bool tB = transB == Transpose::Trans;
+		if (lda < (tA ? M : P) || (beta != 0.0f && ldb < (tB ? M : P)) || ldc < P) {
+			std::cout << "[ERROR] sgeam: leading dimension smaller than the row length.\n";
+			return Join(ctx, deps);
+		}
+		if (M == 0 || P == 0)
+			return Join(ctx, deps);
+		try {
+			return ctx.Queue().submit([&](sycl::handler& h) {
+				h.depends_on(deps);
+				h.parallel_for(sycl::range<2>{M, P}, [=](sycl::id<2> id) {
+					const size_t row = id[0], col = id[1];
+					float out = alpha * (tA ? A[col * lda + row] : A[row * lda + col]);
+					if (beta != 0.0f)
+						out += beta * (tB ? B[col * ldb + row] : B[row * ldb + col]);
+					C[row * ldc + col] = out;
+				});
+			});
+		}
+		catch (sycl::exception const& e) {
+			std::cout << "An exception is caught in sgeam.\n";
+			terminate();
+		}
+	}
+
+	void sgeam(Context& ctx, Transpose transA, Transpose transB,
+		size_t M, size_t P,
+		float alpha, const float* A, size_t lda,
+		float beta, const float* B, size_t ldb,
+		float* C, size_t ldc) {
+		PROFILE_FUNCTION(Time);
+		sycl::event e = sgeam_async(ctx, transA, transB, M, P, alpha, A, lda, beta, B, ldb, C, ldc);
+		e.wait();
+		PROFILE_EVENT(e);
+	}
+}
@@ -0,0 +1,169 @@
+#pragma once
+/*
+Out-of-core SGEMM: operands live in host memory, the device only holds a few blocks.
+
+Blocks of A, B and C are strided in the host arrays. Each one is packed on the host
+into a contiguous pinned staging buffer (sycl::malloc_host) by a host task, and crosses
+the bus as a single copy. Packing, copies and GEMMs are chained by events only, so the
+loop never blocks and chunk k+1 moves while chunk k is multiplied.
+
+Operands in pageable memory (std::vector, malloc) still cost one CPU pass to pack, and
+blocks that are already contiguous are copied straight from them: the runtime stages
+those copies itself, and they do not overlap compute. Pass malloc_host arrays to overlap.
+*/
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "matrix.h"
+#include "nanoblas.h"
+#include "settings.h"
+#include "sgemm.h"
+
+namespace nanoblas {
+	struct StreamPlan {
+		// C is computed in MB x PB blocks. For each block the inner dimension is
+		// streamed in KB-deep chunks of A (MB x KB) and B (KB x PB)
+		size_t MB, PB, KB;
+
+		// Device floats in flight: two buffers each for A and B chunks, one C block
+		size_t Floats() const { return 2 * (MB * KB + KB * PB) + MB * PB; }
+	};
+
+	// Largest blocking whose buffers fit in `fraction` of the device's global memory.
+	// The largest dimension is halved first, down to one 64-wide tile of Kernel-5
+	inline StreamPlan PlanStream(const sycl::device& device, size_t M, size_t P, size_t N, double fraction) {
+		const size_t budget = static_cast<size_t>(fraction * device.get_info<sycl::info::device::global_mem_size>()) / sizeof(float);
+		const size_t maxAlloc = device.get_info<sycl::info::device::max_mem_alloc_size>() / sizeof(float);
+
+		StreamPlan plan{ M, P, N };
+		auto fits = [&]() {
+			return plan.Floats() <= budget
+				&& plan.MB * plan.KB <= maxAlloc && plan.KB * plan.PB <= maxAlloc && plan.MB * plan.PB <= maxAlloc;
+		};
+		while (!fits()) {
+			size_t& largest = (plan.MB >= plan.PB && plan.MB >= plan.KB) ? plan.MB : (plan.PB >= plan.KB ? plan.PB : plan.KB);
+			if (largest <= 64) {
+				std::cout << "[WARN] Streaming GEMM: smallest blocking does not fit the memory budget.\n";
+				break;
+			}
+			largest = RoundUp(largest / 2, 64);
+		}
+		return plan;
+	}
+
+	// rows x cols block between host buffers with different row strides
+	inline void Pack2D(float* dst, size_t dld, const float* src, size_t sld, size_t rows, size_t cols) {
+		for (size_t r = 0; r < rows; r++)
+			std::memcpy(dst + r * dld, src + r * sld, cols * sizeof(float));
+	}
+
+	// Strided host block (row stride sld) into a contiguous device block: packed into
+	// `stage` (pinned, rows * cols) by a host task after deps, then one copy.
+	inline sycl::event Upload2D(Context& ctx, float* dst, const float* src, size_t sld,
+		size_t rows, size_t cols, float* stage, const std::vector<sycl::event>& deps) {
+		if (sld == cols)
+			return ctx.Queue().memcpy(dst, src, rows * cols * sizeof(float), deps);
+		sycl::event packed = ctx.Queue().submit([&](sycl::handler& h) {
+			h.depends_on(deps);
+			h.host_task([=]() { Pack2D(stage, cols, src, sld, rows, cols); });
+		});
+		return ctx.Queue().memcpy(dst, stage, rows * cols * sizeof(float), { packed });
+	}
+
+	// Contiguous device block into a strided host block (row stride dld): one copy
+	// into `stage`, then unpacked by a host task.
+	inline sycl::event Download2D(Context& ctx, float* dst, size_t dld, const float* src,
+		size_t rows, size_t cols, float* stage, const std::vector<sycl::event>& deps) {
+		if (dld == cols)
+			return ctx.Queue().memcpy(dst, src, rows * cols * sizeof(float), deps);
+		sycl::event copied = ctx.Queue().memcpy(stage, src, rows * cols * sizeof(float), deps);
+		return ctx.Queue().submit([&](sycl::handler& h) {
+			h.depends_on(copied);
+			h.host_task([=]() { Pack2D(dst, dld, stage, cols, rows, cols); });
+		});
+	}
+
+	//-----------------------------------------------------------------------------
+	// Out-of-core SGEMM on host-resident, row-major operands:
+	//	C[M x P] = alpha * A[M x N] * B[N x P] + beta * C
+	// Only a StreamPlan's worth of device memory (`fraction` of global memory) is used.
+	// A and B chunks are double buffered: chunk k+1 is copied while chunk k is multiplied.
+	// Strided blocks go through pinned staging as large as the device buffers.
+	// Blocking: returns once C is back on the host.
+	//-----------------------------------------------------------------------------
+	void sgemm_streaming(Context& ctx,
+		size_t M, size_t P, size_t N,
+		float alpha,
+		const float* A, size_t lda,
+		const float* B, size_t ldb,
+		float beta,
+		float* C, size_t ldc,
+		double fraction = DEFAULT_STREAM_MEM_FRACTION) {
+		PROFILE_FUNCTION(Gflops);
+		if (M == 0 || P == 0)
+			return;
+		if (lda < N || ldb < P || ldc < P) {
+			std::cout << "[ERROR] sgemm_streaming: leading dimension smaller than the row length.\n";
+			return;
+		}
+		const StreamPlan plan = PlanStream(ctx.Device(), M, P, N, fraction);
+		std::cout << "Streaming GEMM blocks: " << plan.MB << " x " << plan.PB << " x " << plan.KB
+			<< " (" << plan.Floats() * sizeof(float) / 1024 / 1024 << " MB on device)\n";
+
+		float* Abuf[2] = { ctx.Allocate(plan.MB * plan.KB), ctx.Allocate(plan.MB * plan.KB) };
+		float* Bbuf[2] = { ctx.Allocate(plan.KB * plan.PB), ctx.Allocate(plan.KB * plan.PB) };
+		float* Cbuf = ctx.Allocate(plan.MB * plan.PB);
+		/* Pinned staging of the same shapes, for blocks that are strided on the host */
+		float* Astage[2] = { ctx.AllocateHost(plan.MB * plan.KB), ctx.AllocateHost(plan.MB * plan.KB) };
+		float* Bstage[2] = { ctx.AllocateHost(plan.KB * plan.PB), ctx.AllocateHost(plan.KB * plan.PB) };
+		float* Cstage = ctx.AllocateHost(plan.MB * plan.PB);
+
+		/* Last GEMM that read each chunk buffer, and last use of the C block */
+		sycl::event released[2];
+		sycl::event cDone;
+		size_t chunk = 0;
+
+		for (size_t i0 = 0; i0 < M; i0 += plan.MB) {
+			const size_t mb = std::min(plan.MB, M - i0);
+			for (size_t j0 = 0; j0 < P; j0 += plan.PB) {
+				const size_t pb = std::min(plan.PB, P - j0);
+
+				/* C block on the device. Not read at all when beta == 0 */
+				sycl::event gemm = beta != 0.0f
+					? Upload2D(ctx, Cbuf, C + i0 * ldc + j0, ldc, mb, pb, Cstage, { cDone })
+					: cDone;
+
+				for (size_t k0 = 0; k0 < std::max<size_t>(N, 1); k0 += plan.KB, chunk++) {
+					const size_t kb = std::min(plan.KB, N - k0);
+					const size_t s = chunk % 2;
+
+					/* Refill this slot (and its staging) once the GEMM two chunks back is done with it */
+					sycl::event copyA = Upload2D(ctx, Abuf[s], A + i0 * lda + k0, lda, mb, kb, Astage[s], { released[s] });
+					sycl::event copyB = Upload2D(ctx, Bbuf[s], B + k0 * ldb + j0, ldb, kb, pb, Bstage[s], { released[s] });
+
+					/* Chunks accumulate into the C block in order */
+					const float beta_k = k0 == 0 ? beta : 1.0f;
+					gemm = sgemm_async(ctx, Transpose::None, Transpose::None, mb, pb, kb,
+						alpha, Abuf[s], kb, Bbuf[s], pb, beta_k, Cbuf, pb, { copyA, copyB, gemm });
+					released[s] = gemm;
+					if (N == 0)
+						break;
+				}
+
+				cDone = Download2D(ctx, C + i0 * ldc + j0, ldc, Cbuf, mb, pb, Cstage, { gemm });
+			}
+		}
+
+		cDone.wait();
+		PROFILE_FLOPS(2.0 * M * N * P);
+		for (int s = 0; s < 2; s++) {
+			ctx.Free(Abuf[s]);
+			ctx.Free(Bbuf[s]);
+			ctx.Free(Astage[s]);
+			ctx.Free(Bstage[s]);
+		}
+		ctx.Free(Cbuf);
+		ctx.Free(Cstage);
+	}
+}
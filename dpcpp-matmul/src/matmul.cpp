@@ -6,6 +6,10 @@ Progress (M = N = P = 4096):
 	2. [x] Kernel-2: ~15 GFLOPS | Tiling blocks of A, B in register/on-die cache. TS=8 is ideal for iGPU
 	3. [x] Kernel-3: ~25 GFLOPS | More Work Per Thread. Reducing the total load/stores
 	4. [x] Kernel-4: ~27 GFLOPS | Wider Load/Store. No WPT 
+	5. [x] Kernel-5: 2D register blocking. WPTM x WPTN outer products per thread from larger TSM x TSK, TSK x TSN tiles
+	6. [x] Kernel-6: Kernels 2, 3 with double-buffered tiles. Next tile is loaded during compute, one barrier per tile
+	7. [x] Kernel-7: Sub-group broadcast of A, B in registers. No local memory, no work-group barriers
+Each kernel run is placed on the device's measured roofline (roofline.h), written to roofline.csv
 
 */
 
@@ -15,35 +19,102 @@ Progress (M = N = P = 4096):
 
 #include "common.h"
 #include "nanoblas.h"
+#include "registry.h"
+#include "autotune.h"
+#include "sgemm.h"
+#include "graph.h"
+#include "streaming.h"
+#include "matfile.h"
+#include "philox.h"
+#include "roofline.h"
+#include "freivalds.h"
 
 #if SIZE <= 16
 #define DEBUG 1
 #endif
+/* 1: elementwise against the CPU GEMM. 2: Freivalds check of every C in O(n^2) (freivalds.h) */
+#if SIZE >= 4096
+#define VERIFY 2
+#else
 #define VERIFY 1
+#endif
 
-int main() {
+/*
+Usage: matmul [config | autotune] [-a A.nbm] [-b B.nbm] [-c C.nbm]
+	config: any name from nanoblas::Registry (eg: wpt_ts16_wpt4). 
+	It replaces the default configuration of its kernel for this run.
+	autotune: sweep all configurations on this device and cache the fastest.
+	Without arguments, the cached winner for this device and shape is used if any.
+	-a, -b: memory-map A [M x N] and B [N x P] from row-major .nbm files (matfile.h) instead of random data.
+	-c: write the BLAS front end's C to a .nbm file.
+*/
+int main(int argc, char** argv) {
 	pfr::Instrumentor::Get().BeginSession("GPU MatMul");
-	PROFILE_FUNCTION("time");
+	pfr::Instrumentor::Get().EchoScopes(true);	// Demo: a console line per kernel
+	PROFILE_FUNCTION(Time);
 
-	/* set seed */
-	srand(39872);
+	/* Seed of the operand streams: A is stream 0, B stream 1 */
+	constexpr uint64_t seed = 39872;
 
 	// Matrix size definitions
 	constexpr size_t M = 1 * SIZE;
 	constexpr size_t N = 1 * SIZE;
 	constexpr size_t P = 1 * SIZE;
 
+	/* Runtime kernel configuration and operand files */
+	const nanoblas::GemmEntry* config = nullptr;
+	bool autotune = false;
+	std::string a_path, b_path, c_path;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if ((arg == "-a" || arg == "-b" || arg == "-c") && i + 1 < argc)
+			(arg == "-a" ? a_path : arg == "-b" ? b_path : c_path) = argv[++i];
+		else if (arg == "autotune")
+			autotune = true;
+		else if ((config = nanoblas::Registry::Get().Find(arg)) == nullptr) {
+			std::cout << "Unknown configuration: " << arg << "\n";
+			nanoblas::Registry::Get().Print();
+			return -1;
+		}
+	}
+
+	/* Mapped operands are used in place: no read, no staging copy */
+	auto map = [](const std::string& path, size_t rows, size_t cols, nanoblas::MappedMatrix& file) {
+		file = nanoblas::MappedMatrix(path);
+		if (file && (file.Rows() != rows || file.Cols() != cols || file.Order() != nanoblas::Layout::RowMajor)) {
+			std::cout << path << " is not a row-major " << rows << " x " << cols << " matrix.\n";
+			file = nanoblas::MappedMatrix();
+		}
+		return bool(file);
+	};
+	nanoblas::MappedMatrix a_file, b_file;
+	if ((!a_path.empty() && !map(a_path, M, N, a_file)) || (!b_path.empty() && !map(b_path, N, P, b_file)))
+		return -1;
+
 	// float ptr matrix. &a_host points to the data.
-	float* a_host = (float*)malloc(M * N * sizeof(float*));
-	float* b_host = (float*)malloc(N * P * sizeof(float*));
+	float* a_host = a_file ? a_file.Data() : (float*)malloc(M * N * sizeof(float*));
+	float* b_host = b_file ? b_file.Data() : (float*)malloc(N * P * sizeof(float*));
 
 	float* c_gemm = (float*)malloc(M * P * sizeof(float*));
 	float* c_gemm2 = (float*)malloc(M * P * sizeof(float*));
 	float* c_gemm3 = (float*)malloc(M * P * sizeof(float*));
 	float* c_gemm4 = (float*)malloc(M * P * sizeof(float*));
-	
-	for (size_t i = 0; i < M * N; i++) { a_host[i] = rand() % 5; }
-	for (size_t i = 0; i < N * P; i++) { b_host[i] = rand() % 5; }
+	float* c_gemm5 = (float*)malloc(M * P * sizeof(float*));
+	float* c_gemm6 = (float*)malloc(M * P * sizeof(float*));
+	float* c_gemm7 = (float*)malloc(M * P * sizeof(float*));
+	float* c_gemm8 = (float*)malloc(M * P * sizeof(float*));
+	float* c_sgemm = (float*)malloc(M * P * sizeof(float*));
+	float* c_batched = (float*)malloc(M * P * sizeof(float*));
+	float* c_async = (float*)malloc(M * P * sizeof(float*));
+	float* c_graph = (float*)malloc(M * P * sizeof(float*));
+	float* c_stream = (float*)malloc(M * P * sizeof(float*));
+
+	/* Counter-based: same values for any thread count */
+	auto small_int = [](uint32_t word) { return float(word % 5); };
+	if (!a_file)
+		nanoblas::PhiloxFillHost(nanoblas::Philox(seed, 0), a_host, M * N, small_int);
+	if (!b_file)
+		nanoblas::PhiloxFillHost(nanoblas::Philox(seed, 1), b_host, N * P, small_int);
 
 	/*
 	Now the standard procedure of 
@@ -53,35 +124,136 @@ int main() {
 	*/
 	#if true
 	try {
-		sycl::queue q = create_device_queue();
+		nanoblas::Context ctx(create_device_queue());
+
+		/* Upload A and B once, they stay resident on the device for all kernels */
+		nanoblas::Matrix a(ctx, M, N, a_host);
+		nanoblas::Matrix b(ctx, N, P, b_host);
+		nanoblas::Matrix c(ctx, M, P);
+
+		nanoblas::Autotuner tuner;
+		if (autotune)
+			config = &tuner.Tune(ctx, a, b, c);
+		else if (config == nullptr)
+			config = tuner.Select(ctx, M, N, P);
+		if (config != nullptr)
+			std::cout << "Using configuration: " << config->Config.Name() << "\n";
+
+		/* Sustained bandwidth and peak FLOPs of this device */
+		nanoblas::RooflineReport roofline(nanoblas::MeasurePeaks(ctx));
+
 		/* Kernel-1 Basic Parallel method with too many memory accesses */
-		MatrixMulParallelNaive(q, M, N, P, a_host, b_host, c_gemm);	
+		roofline.Add(nanoblas::DefaultConfig(nanoblas::KernelId::Naive), M, N, P,
+			nanoblas::KernelSeconds([&]() { MatrixMulParallelNaive(ctx, a, b, c); }));
+		c.CopyToHost(c_gemm);
+		/* Default configuration of a kernel, unless the selected config is of that kernel */
+		auto run = [&](nanoblas::KernelId kernel, nanoblas::GemmFn fallback) {
+			const bool selected = config != nullptr && config->Config.Kernel == kernel;
+			const double seconds = nanoblas::KernelSeconds([&]() {
+				if (selected)
+					(*config)(ctx, a, b, c);
+				else
+					fallback(ctx, a, b, c);
+			});
+			roofline.Add(selected ? config->Config : nanoblas::DefaultConfig(kernel), M, N, P, seconds);
+		};
+
 		/* Kernel-2 8x8 tiled method */
-		MatrixMulTiled(q, M, N, P, a_host, b_host, c_gemm2);
-		MatrixMulTiled(q, M, N, P, a_host, b_host, c_gemm2);
-		MatrixMulTiled(q, M, N, P, a_host, b_host, c_gemm2);
+		run(nanoblas::KernelId::Tiled, MatrixMulTiled);
+		run(nanoblas::KernelId::Tiled, MatrixMulTiled);
+		run(nanoblas::KernelId::Tiled, MatrixMulTiled);
+		c.CopyToHost(c_gemm2);
 		/* Kernel-3 Tiling + WPT */
-		MatrixMulWPT(q, M, N, P, a_host, b_host, c_gemm3);
-		MatrixMulWPT(q, M, N, P, a_host, b_host, c_gemm3);
-		MatrixMulWPT(q, M, N, P, a_host, b_host, c_gemm3);
+		run(nanoblas::KernelId::WPT, MatrixMulWPT);
+		run(nanoblas::KernelId::WPT, MatrixMulWPT);
+		run(nanoblas::KernelId::WPT, MatrixMulWPT);
+		c.CopyToHost(c_gemm3);
 		/* Kernel-4 Tiling + Wide WPT */
-		MatrixMulWideWPT(q, M, N, P, a_host, b_host, c_gemm4);
-		MatrixMulWideWPT(q, M, N, P, a_host, b_host, c_gemm4);
-		MatrixMulWideWPT(q, M, N, P, a_host, b_host, c_gemm4);
+		run(nanoblas::KernelId::WideWPT, MatrixMulWideWPT);
+		run(nanoblas::KernelId::WideWPT, MatrixMulWideWPT);
+		run(nanoblas::KernelId::WideWPT, MatrixMulWideWPT);
+		c.CopyToHost(c_gemm4);
+		/* Kernel-5 2D register blocking */
+		run(nanoblas::KernelId::RegBlock, MatrixMulRegBlock);
+		run(nanoblas::KernelId::RegBlock, MatrixMulRegBlock);
+		run(nanoblas::KernelId::RegBlock, MatrixMulRegBlock);
+		c.CopyToHost(c_gemm5);
+		/* Kernel-6 Kernels 2, 3 with double-buffered tiles */
+		run(nanoblas::KernelId::TiledPrefetch, MatrixMulTiledPrefetch);
+		run(nanoblas::KernelId::TiledPrefetch, MatrixMulTiledPrefetch);
+		run(nanoblas::KernelId::TiledPrefetch, MatrixMulTiledPrefetch);
+		c.CopyToHost(c_gemm6);
+		run(nanoblas::KernelId::WPTPrefetch, MatrixMulWPTPrefetch);
+		run(nanoblas::KernelId::WPTPrefetch, MatrixMulWPTPrefetch);
+		run(nanoblas::KernelId::WPTPrefetch, MatrixMulWPTPrefetch);
+		c.CopyToHost(c_gemm7);
+		/* Kernel-7 Sub-group shuffles, in a sub-group size the device supports */
+		const nanoblas::GemmEntry* subgroup = nullptr;
+		if (config != nullptr && config->Config.Kernel == nanoblas::KernelId::SubGroup && nanoblas::Autotuner::Fits(config->Config, ctx.Device()))
+			subgroup = config;
+		const nanoblas::GemmEntry* sg_default = nanoblas::Registry::Get().Find(nanoblas::DefaultConfig(nanoblas::KernelId::SubGroup).Name());
+		if (subgroup == nullptr && sg_default != nullptr && nanoblas::Autotuner::Fits(sg_default->Config, ctx.Device()))
+			subgroup = sg_default;
+		for (const nanoblas::GemmEntry& entry : nanoblas::Registry::Get().Entries())
+			if (subgroup == nullptr && entry.Config.Kernel == nanoblas::KernelId::SubGroup && nanoblas::Autotuner::Fits(entry.Config, ctx.Device()))
+				subgroup = &entry;
+		if (subgroup != nullptr) {
+			for (int r = 0; r < 3; r++)
+				roofline.Add(subgroup->Config, M, N, P, nanoblas::KernelSeconds([&]() { (*subgroup)(ctx, a, b, c); }));
+			c.CopyToHost(c_gemm8);
+		}
+		else {
+			std::cout << "Skipping Kernel-7: the device supports none of the compiled sub-group sizes.\n";
+			free(c_gemm8);
+			c_gemm8 = nullptr;
+		}
+		/* BLAS front end: C = 2 * A * B - C, with C holding A * B */
+		nanoblas::sgemm(ctx, nanoblas::Transpose::None, nanoblas::Transpose::None, 2.0f, a, b, -1.0f, c);
+		c.CopyToHost(c_sgemm);
+		/* Strided batch: row panel i of C = row panel i of A * B, all panels in one launch */
+		constexpr size_t batch_count = 16;
+		constexpr size_t rows = M / batch_count;
+		nanoblas::sgemm_strided_batched(ctx, nanoblas::Transpose::None, nanoblas::Transpose::None, rows, P, N,
+			1.0f, a.Data(), N, rows * N, b.Data(), P, 0, 0.0f, c.Data(), P, rows * P, batch_count);
+		c.CopyToHost(c_batched);
+		/* Async chain: C = A * B, then C = 2 * A * B - C, then copy back. Enqueued back to back, one wait */
+		sycl::event e1 = nanoblas::sgemm_async(ctx, nanoblas::Transpose::None, nanoblas::Transpose::None, 1.0f, a, b, 0.0f, c);
+		sycl::event e2 = nanoblas::sgemm_async(ctx, nanoblas::Transpose::None, nanoblas::Transpose::None, 2.0f, a, b, -1.0f, c, { e1 });
+		c.CopyToHostAsync(c_async, { e2 }).wait();
+		/* Recorded graph: T = A * B; C = T fuses into one GEMM, B^T into T is dead. Replayed twice */
+		{
+			nanoblas::Matrix t(ctx, M, P);
+			nanoblas::Graph graph(ctx);
+			graph.Gemm(nanoblas::Transpose::None, nanoblas::Transpose::None, 1.0f, a, b, 0.0f, t);
+			graph.Geam(nanoblas::Transpose::None, nanoblas::Transpose::None, 1.0f, t, 0.0f, t, c);
+			graph.TransposeTo(b, t);
+			graph.Output(c);
+			graph.Print();
+			graph.Run().wait();
+			c.CopyToHostAsync(c_graph, { graph.Run() }).wait();
+		}
+		/* Out-of-core: host operands streamed through a budget of 1% of device memory */
+		nanoblas::sgemm_streaming(ctx, M, P, N, 1.0f, a_host, N, b_host, P, 0.0f, c_stream, P, 0.01);
 
+		roofline.Print();
+		roofline.WriteCsv("roofline.csv");
 	}
 	catch (std::exception const& e) {
 		std::cout << "Exception while multiplying on GPU.\n";
 	}
 	#endif
 
+	if (!c_path.empty())
+		nanoblas::WriteMatrixFile(c_path, M, P, c_sgemm);
+
 	#if DEBUG
 	std::cout << "A_host\n";
 	print_matrix(M, N, a_host);
 	std::cout << "B_host\n";
 	print_matrix(N, P, b_host);
 
-	/*floatX* a_hostX = reinterpret_cast<floatX*>(a_host);
+	/*using floatX = sycl::vec<float, DEFAULT_WIDTH>;
+	floatX* a_hostX = reinterpret_cast<floatX*>(a_host);
 	floatX* b_hostX = reinterpret_cast<floatX*>(b_host);
 	std::cout << "A_hostX\n";
 	print_matrix(M, N, a_hostX);
@@ -94,14 +266,28 @@ int main() {
 	print_matrix(M, P, c_gemm4);
 	#endif
 
-	#if VERIFY
-	//float* c_host = (float*)malloc(M * P * sizeof(float*));
-	//MatrixMulCPU(M, N, P, a_host, b_host, c_host);
-	float* c_host = c_gemm;
+	#if VERIFY == 2
+	for (const float* c_gpu : { c_gemm, c_gemm2, c_gemm3, c_gemm4, c_gemm5, c_gemm6, c_gemm7, c_gemm8,
+		c_sgemm, c_batched, c_async, c_graph, c_stream })
+		if (c_gpu != nullptr)
+			nanoblas::VerifyFreivalds(M, N, P, a_host, b_host, c_gpu);
+	#elif VERIFY
+	float* c_host = (float*)malloc(M * P * sizeof(float*));
+	MatrixMulCPU(M, N, P, a_host, b_host, c_host);
 	Verify<float>::VerifyResult(M, P, c_gemm, c_host);
 	Verify<float>::VerifyResult(M, P, c_gemm2, c_host);
 	Verify<float>::VerifyResult(M, P, c_gemm3, c_host);
 	Verify<float>::VerifyResult(M, P, c_gemm4, c_host);
+	Verify<float>::VerifyResult(M, P, c_gemm5, c_host);
+	Verify<float>::VerifyResult(M, P, c_gemm6, c_host);
+	Verify<float>::VerifyResult(M, P, c_gemm7, c_host);
+	if (c_gemm8 != nullptr)
+		Verify<float>::VerifyResult(M, P, c_gemm8, c_host);
+	Verify<float>::VerifyResult(M, P, c_sgemm, c_host);
+	Verify<float>::VerifyResult(M, P, c_batched, c_host);
+	Verify<float>::VerifyResult(M, P, c_async, c_host);
+	Verify<float>::VerifyResult(M, P, c_graph, c_host);
+	Verify<float>::VerifyResult(M, P, c_stream, c_host);
 	#endif
 	pfr::Instrumentor::Get().EndSession();
 	return 0;
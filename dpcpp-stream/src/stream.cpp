@@ -0,0 +1,445 @@
+/*
+STREAM-style memory bandwidth benchmark (J. McCalpin, https://www.cs.virginia.edu/stream/).
+	copy:  c = a			2 words per element
+	scale: b = s * c		2 words
+	add:   c = a + b		3 words
+	triad: a = b + s * c	3 words
+for each memory model:
+	host:    std::threads over host memory, no SYCL
+	buffer:  sycl::buffer with accessors
+	device, shared, hostusm: sycl::malloc_device / malloc_shared / malloc_host
+The device's best rate is the bandwidth roof of the nanoblas roofline report, and the
+spread between models shows which one the kernels should use.
+
+Usage: stream [-n sizes] [-t types] [-m models] [-w warmup] [-r reps] [--csv file]
+	-n: comma separated element counts. Default: 67108864
+	-t: comma separated float, double, int. Default: float
+	-m: comma separated host, buffer, device, shared, hostusm or "all". Default: all
+	-w: untimed iterations first, the first one pays JIT compilation. Default: 2
+	-r: timed iterations. Default: 10
+	--csv: also write the results to a file
+Arrays are reset between iterations (untimed), so the values stay small and exact for any
+type and any count: after one iteration a = 15, b = 3, c = 4, which every model is checked against.
+*/
+
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class Kernel { Copy, Scale, Add, Triad };
+constexpr Kernel KERNELS[] = { Kernel::Copy, Kernel::Scale, Kernel::Add, Kernel::Triad };
+constexpr const char* KERNEL_NAMES[] = { "copy", "scale", "add", "triad" };
+constexpr int KERNEL_WORDS[] = { 2, 2, 3, 3 };
+
+struct Result {
+	std::string Model, Type, Kernel;
+	size_t N;
+	double BestGBps, Avg, Min, Max;		// Seconds per call
+};
+
+std::vector<std::string> Split(const std::string& list, char sep) {
+	std::vector<std::string> items;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, sep))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+// Create an asynchronous Exception Handler for sycl
+static auto exception_handler = [](sycl::exception_list eList) {
+	for (std::exception_ptr const& e : eList) {
+		try {
+			std::rethrow_exception(e);
+		}
+		catch (std::exception const& e) {
+			std::cout << "Failure: " << e.what() << std::endl;
+			std::terminate();
+		}
+	}
+};
+
+template <typename T>
+class StreamArrays {
+	// a, b, c of n elements in one memory model. Every call is blocking.
+public:
+	virtual ~StreamArrays() = default;
+	virtual void Reset() = 0;							// a = 1, b = 2, c = 0
+	virtual void Run(Kernel kernel, T scalar) = 0;
+	virtual void Fetch(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c) = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Host threads, each on its own contiguous slice. Slices are first touched by
+// the thread that uses them, so pages land on that thread's memory node.
+//-----------------------------------------------------------------------------
+template <typename T>
+class HostArrays : public StreamArrays<T> {
+private:
+	size_t m_N, m_Threads;
+	std::unique_ptr<T[]> m_A, m_B, m_C;
+
+	template <typename F>
+	void Parallel(F f) {
+		auto worker = [&](size_t t) { f(m_N * t / m_Threads, m_N * (t + 1) / m_Threads); };
+		std::vector<std::thread> pool;
+		for (size_t t = 1; t < m_Threads; t++)
+			pool.emplace_back(worker, t);
+		worker(0);
+		for (auto& thread : pool)
+			thread.join();
+	}
+
+public:
+	explicit HostArrays(size_t n)
+		: m_N(n), m_Threads(std::max<size_t>(1, std::thread::hardware_concurrency())),
+		m_A(new T[n]), m_B(new T[n]), m_C(new T[n])
+	{
+
+	}
+
+	void Reset() override {
+		T* a = m_A.get(); T* b = m_B.get(); T* c = m_C.get();
+		Parallel([=](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) { a[i] = 1; b[i] = 2; c[i] = 0; }
+		});
+	}
+
+	void Run(Kernel kernel, T s) override {
+		T* a = m_A.get(); T* b = m_B.get(); T* c = m_C.get();
+		switch (kernel) {
+		case Kernel::Copy: Parallel([=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) c[i] = a[i]; }); break;
+		case Kernel::Scale: Parallel([=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) b[i] = s * c[i]; }); break;
+		case Kernel::Add: Parallel([=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) c[i] = a[i] + b[i]; }); break;
+		case Kernel::Triad: Parallel([=](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) a[i] = b[i] + s * c[i]; }); break;
+		}
+	}
+
+	void Fetch(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c) override {
+		a.assign(m_A.get(), m_A.get() + m_N);
+		b.assign(m_B.get(), m_B.get() + m_N);
+		c.assign(m_C.get(), m_C.get() + m_N);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// sycl::buffer: the runtime tracks the accessors of every kernel and decides
+// where the data lives. Nothing but the kernels touches the buffers until Fetch.
+//-----------------------------------------------------------------------------
+template <typename T>
+class BufferArrays : public StreamArrays<T> {
+private:
+	sycl::queue& m_Queue;
+	size_t m_N;
+	sycl::buffer<T, 1> m_A, m_B, m_C;
+
+public:
+	BufferArrays(sycl::queue& q, size_t n)
+		: m_Queue(q), m_N(n), m_A(sycl::range<1>{ n }), m_B(sycl::range<1>{ n }), m_C(sycl::range<1>{ n })
+	{
+
+	}
+
+	void Reset() override {
+		m_Queue.submit([&](sycl::handler& h) {
+			auto a = m_A.template get_access<sycl::access::mode::discard_write>(h);
+			auto b = m_B.template get_access<sycl::access::mode::discard_write>(h);
+			auto c = m_C.template get_access<sycl::access::mode::discard_write>(h);
+			h.parallel_for(sycl::range<1>{ m_N }, [=](sycl::id<1> i) { a[i] = 1; b[i] = 2; c[i] = 0; });
+		}).wait();
+	}
+
+	void Run(Kernel kernel, T s) override {
+		sycl::event e = m_Queue.submit([&](sycl::handler& h) {
+			const sycl::range<1> n{ m_N };
+			switch (kernel) {
+			case Kernel::Copy: {
+				auto a = m_A.template get_access<sycl::access::mode::read>(h);
+				auto c = m_C.template get_access<sycl::access::mode::discard_write>(h);
+				h.parallel_for(n, [=](sycl::id<1> i) { c[i] = a[i]; });
+				break;
+			}
+			case Kernel::Scale: {
+				auto c = m_C.template get_access<sycl::access::mode::read>(h);
+				auto b = m_B.template get_access<sycl::access::mode::discard_write>(h);
+				h.parallel_for(n, [=](sycl::id<1> i) { b[i] = s * c[i]; });
+				break;
+			}
+			case Kernel::Add: {
+				auto a = m_A.template get_access<sycl::access::mode::read>(h);
+				auto b = m_B.template get_access<sycl::access::mode::read>(h);
+				auto c = m_C.template get_access<sycl::access::mode::discard_write>(h);
+				h.parallel_for(n, [=](sycl::id<1> i) { c[i] = a[i] + b[i]; });
+				break;
+			}
+			case Kernel::Triad: {
+				auto b = m_B.template get_access<sycl::access::mode::read>(h);
+				auto c = m_C.template get_access<sycl::access::mode::read>(h);
+				auto a = m_A.template get_access<sycl::access::mode::discard_write>(h);
+				h.parallel_for(n, [=](sycl::id<1> i) { a[i] = b[i] + s * c[i]; });
+				break;
+			}
+			}
+		});
+		e.wait();
+	}
+
+	void Fetch(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c) override {
+		auto copy = [&](sycl::buffer<T, 1>& buf, std::vector<T>& out) {
+			auto host = buf.template get_access<sycl::access::mode::read>();
+			out.resize(m_N);
+			for (size_t i = 0; i < m_N; i++)
+				out[i] = host[i];
+		};
+		copy(m_A, a);
+		copy(m_B, b);
+		copy(m_C, c);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// USM of one kind, plain pointers in the kernels. Shared pages migrate to the
+// device on first touch (Reset runs on the device), host allocations stay in
+// host memory and are read over the bus by every kernel.
+//-----------------------------------------------------------------------------
+template <typename T>
+class UsmArrays : public StreamArrays<T> {
+private:
+	sycl::queue& m_Queue;
+	size_t m_N;
+	T* m_A;
+	T* m_B;
+	T* m_C;
+
+	T* Allocate(sycl::usm::alloc kind) {
+		T* ptr = nullptr;
+		switch (kind) {
+		case sycl::usm::alloc::device: ptr = sycl::malloc_device<T>(m_N, m_Queue); break;
+		case sycl::usm::alloc::shared: ptr = sycl::malloc_shared<T>(m_N, m_Queue); break;
+		default: ptr = sycl::malloc_host<T>(m_N, m_Queue); break;
+		}
+		if (ptr == nullptr) {
+			std::cout << "Failed to allocate " << m_N * sizeof(T) / 1024 / 1024 << " MB of USM.\n";
+			std::terminate();
+		}
+		return ptr;
+	}
+
+public:
+	UsmArrays(sycl::queue& q, size_t n, sycl::usm::alloc kind)
+		: m_Queue(q), m_N(n), m_A(Allocate(kind)), m_B(Allocate(kind)), m_C(Allocate(kind))
+	{
+
+	}
+
+	~UsmArrays() override {
+		sycl::free(m_A, m_Queue);
+		sycl::free(m_B, m_Queue);
+		sycl::free(m_C, m_Queue);
+	}
+
+	void Reset() override {
+		T* a = m_A; T* b = m_B; T* c = m_C;
+		m_Queue.parallel_for(sycl::range<1>{ m_N }, [=](sycl::id<1> i) { a[i] = 1; b[i] = 2; c[i] = 0; }).wait();
+	}
+
+	void Run(Kernel kernel, T s) override {
+		T* a = m_A; T* b = m_B; T* c = m_C;
+		const sycl::range<1> n{ m_N };
+		sycl::event e;
+		switch (kernel) {
+		case Kernel::Copy: e = m_Queue.parallel_for(n, [=](sycl::id<1> i) { c[i] = a[i]; }); break;
+		case Kernel::Scale: e = m_Queue.parallel_for(n, [=](sycl::id<1> i) { b[i] = s * c[i]; }); break;
+		case Kernel::Add: e = m_Queue.parallel_for(n, [=](sycl::id<1> i) { c[i] = a[i] + b[i]; }); break;
+		case Kernel::Triad: e = m_Queue.parallel_for(n, [=](sycl::id<1> i) { a[i] = b[i] + s * c[i]; }); break;
+		}
+		e.wait();
+	}
+
+	void Fetch(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c) override {
+		a.resize(m_N); b.resize(m_N); c.resize(m_N);
+		m_Queue.memcpy(a.data(), m_A, m_N * sizeof(T));
+		m_Queue.memcpy(b.data(), m_B, m_N * sizeof(T));
+		m_Queue.memcpy(c.data(), m_C, m_N * sizeof(T));
+		m_Queue.wait();
+	}
+};
+
+// Every element must be a = 15, b = 3, c = 4 after an iteration from the reset state
+template <typename T>
+bool Validate(StreamArrays<T>& arrays) {
+	std::vector<T> a, b, c;
+	arrays.Fetch(a, b, c);
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i] != T(15) || b[i] != T(3) || c[i] != T(4)) {
+			std::cout << "Failed validation at [" << i << "]: a = " << a[i] << ", b = " << b[i] << ", c = " << c[i] << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+void RunModel(const std::string& model, const std::string& type, StreamArrays<T>& arrays, size_t n,
+	int warmup, int reps, std::vector<Result>& results) {
+	constexpr T scalar = 3;
+	std::vector<double> times[4];
+	for (int iter = 0; iter < warmup + reps; iter++) {
+		arrays.Reset();
+		for (int k = 0; k < 4; k++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			arrays.Run(KERNELS[k], scalar);
+			auto end = std::chrono::high_resolution_clock::now();
+			if (iter >= warmup)
+				times[k].push_back(std::chrono::duration<double>(end - start).count());
+		}
+	}
+	if (!Validate(arrays))
+		return;
+	for (int k = 0; k < 4; k++) {
+		const auto minmax = std::minmax_element(times[k].begin(), times[k].end());
+		double avg = 0;
+		for (double t : times[k])
+			avg += t;
+		avg /= times[k].size();
+		const double bytes = static_cast<double>(KERNEL_WORDS[k]) * n * sizeof(T);
+		results.push_back({ model, type, KERNEL_NAMES[k], n, bytes * 1e-9 / *minmax.first, avg, *minmax.first, *minmax.second });
+	}
+}
+
+template <typename T>
+void RunType(sycl::queue& q, const std::string& type, const std::vector<std::string>& models, size_t n,
+	int warmup, int reps, std::vector<Result>& results) {
+	const bool fp64 = !std::is_same<T, double>::value || q.get_device().has(sycl::aspect::fp64);
+	for (const std::string& model : models) {
+		std::cerr << "\t" << model << " " << type << " x " << n << "\n";
+		if (model == "host") {
+			HostArrays<T> arrays(n);
+			RunModel(model, type, arrays, n, warmup, reps, results);
+			continue;
+		}
+		if (!fp64) {
+			std::cerr << "\t\tSkipping: the device has no fp64\n";
+			continue;
+		}
+		if (model == "buffer") {
+			BufferArrays<T> arrays(q, n);
+			RunModel(model, type, arrays, n, warmup, reps, results);
+		}
+		else {
+			const sycl::usm::alloc kind = model == "device" ? sycl::usm::alloc::device
+				: model == "shared" ? sycl::usm::alloc::shared : sycl::usm::alloc::host;
+			UsmArrays<T> arrays(q, n, kind);
+			RunModel(model, type, arrays, n, warmup, reps, results);
+		}
+	}
+}
+
+void Print(const std::vector<Result>& results) {
+	std::cout << std::left << std::setw(9) << "model" << std::setw(8) << "type" << std::setw(12) << "n" << std::setw(7) << "kernel"
+		<< std::right << std::setw(12) << "best GB/s" << std::setw(12) << "avg s" << std::setw(12) << "min s" << std::setw(12) << "max s" << "\n";
+	for (const Result& r : results) {
+		std::cout << std::left << std::setw(9) << r.Model << std::setw(8) << r.Type << std::setw(12) << r.N << std::setw(7) << r.Kernel
+			<< std::right << std::setw(12) << std::fixed << std::setprecision(2) << r.BestGBps
+			<< std::scientific << std::setprecision(3) << std::setw(12) << r.Avg << std::setw(12) << r.Min << std::setw(12) << r.Max << "\n";
+		std::cout.unsetf(std::ios::floatfield);
+	}
+}
+
+void WriteCsv(std::ostream& out, const std::vector<Result>& results) {
+	out << "model,type,n,kernel,best_gbps,avg_s,min_s,max_s\n";
+	for (const Result& r : results)
+		out << r.Model << "," << r.Type << "," << r.N << "," << r.Kernel << "," << r.BestGBps << ","
+			<< r.Avg << "," << r.Min << "," << r.Max << "\n";
+}
+
+int main(int argc, char** argv) {
+	std::vector<size_t> sizes{ 64 << 20 };
+	std::vector<std::string> types{ "float" };
+	std::vector<std::string> models{ "all" };
+	int warmup = 2, reps = 10;
+	std::string csvPath;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "-n" && hasValue) {
+			sizes.clear();
+			for (const std::string& text : Split(argv[++i], ',')) {
+				const size_t n = std::strtoull(text.c_str(), nullptr, 10);
+				if (n == 0) {
+					std::cout << "Bad size: " << text << "\n";
+					return -1;
+				}
+				sizes.push_back(n);
+			}
+		}
+		else if (arg == "-t" && hasValue)
+			types = Split(argv[++i], ',');
+		else if (arg == "-m" && hasValue)
+			models = Split(argv[++i], ',');
+		else if (arg == "-w" && hasValue)
+			warmup = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-r" && hasValue)
+			reps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--csv" && hasValue)
+			csvPath = argv[++i];
+		else {
+			std::cout << "Unknown argument: " << arg << "\n";
+			return -1;
+		}
+	}
+
+	if (models.size() == 1 && models[0] == "all")
+		models = { "host", "buffer", "device", "shared", "hostusm" };
+	for (const std::string& model : models) {
+		if (model != "host" && model != "buffer" && model != "device" && model != "shared" && model != "hostusm") {
+			std::cout << "Unknown memory model: " << model << " (host, buffer, device, shared, hostusm or all)\n";
+			return -1;
+		}
+	}
+	for (const std::string& type : types) {
+		if (type != "float" && type != "double" && type != "int") {
+			std::cout << "Unknown type: " << type << " (float, double or int)\n";
+			return -1;
+		}
+	}
+
+	std::vector<Result> results;
+	try {
+		sycl::queue q(sycl::default_selector{}, exception_handler);
+		std::cout << "Accelerator: " << q.get_device().get_info<sycl::info::device::name>() << "\n";
+		for (size_t n : sizes) {
+			for (const std::string& type : types) {
+				if (type == "float")
+					RunType<float>(q, type, models, n, warmup, reps, results);
+				else if (type == "double")
+					RunType<double>(q, type, models, n, warmup, reps, results);
+				else
+					RunType<int>(q, type, models, n, warmup, reps, results);
+			}
+		}
+	}
+	catch (std::exception const& e) {
+		std::cout << "Exception while benchmarking: " << e.what() << "\n";
+		return -1;
+	}
+
+	Print(results);
+	if (!csvPath.empty()) {
+		std::ofstream csv(csvPath);
+		WriteCsv(csv, results);
+	}
+	return 0;
+}